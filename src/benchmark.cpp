@@ -1,13 +1,170 @@
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
 #include "benchmark.h"
+#include "evaluation.h"
+#include "movegen.h"
 #include "search.h"
+#include "str_utils.h"
 #include "thread.h"
+#include "uci.h"
 
 extern ThreadPool Threads;
 
 namespace bench {
 
-int run(int depth) {
+namespace {
+
+enum class UpdateMode { NONE, COPY, FUSED };
+
+struct MoveWalker {
+    Board board;
+    UpdateMode mode;
+
+    // accumulator of every ply of the walk, computed eagerly after each move
+    std::vector<nnue::accumulator> stack = std::vector<nnue::accumulator>(MAX_PLY + 1);
+    std::array<Movelist, MAX_PLY> movelists;
+
+    U64 moves = 0;
+    int32_t checksum = 0;
+
+    void update(int ply) {
+        const DirtyPieces &dirty = board.accumulators().dirty();
+        const nnue::accumulator &parent = stack[ply - 1];
+        nnue::accumulator &acc = stack[ply];
+
+        for (Color perspective : {WHITE, BLACK}) {
+            if (dirty.refresh[perspective]) {
+                board.refreshNNUE(acc, perspective);
+                continue;
+            }
+
+            const Square ksq = perspective == WHITE ? dirty.ksq_white : dirty.ksq_black;
+
+            if (mode == UpdateMode::FUSED) {
+                dirty.apply(parent, acc, perspective);
+                continue;
+            }
+
+            // copy the parent and apply every feature on its own
+            acc[perspective] = parent[perspective];
+
+            for (int i = 0; i < dirty.added_count; i++)
+                nnue::activate(acc[perspective], perspective, dirty.added[i].sq,
+                               dirty.added[i].piece, ksq);
+            for (int i = 0; i < dirty.removed_count; i++)
+                nnue::deactivate(acc[perspective], perspective, dirty.removed[i].sq,
+                                 dirty.removed[i].piece, ksq);
+        }
+    }
+
+    void walk(int ply, int depth) {
+        if (depth == 0) {
+            checksum += stack[ply][WHITE][0] + stack[ply][BLACK][nnue::hiddenSize() - 1];
+            return;
+        }
+
+        Movelist &moves_ply = movelists[ply];
+        moves_ply.size = 0;
+        movegen::legalmoves<Movetype::ALL>(board, moves_ply);
+
+        for (auto extmove : moves_ply) {
+            board.makeMove<true>(extmove.move);
+            if (mode != UpdateMode::NONE) update(ply + 1);
+
+            moves++;
+            walk(ply + 1, depth - 1);
+
+            board.unmakeMove<false>(extmove.move);
+        }
+    }
+};
+
+// discards the output and remembers when the first line was flushed
+class FirstLineBuffer : public std::stringbuf {
+   public:
+    void reset() {
+        str("");
+        flushed_ = false;
+    }
+
+    [[nodiscard]] bool flushed() const { return flushed_; }
+    [[nodiscard]] TimePoint::time_point time() const { return time_; }
+
+   protected:
+    int sync() override {
+        if (!flushed_) time_ = TimePoint::now();
+        flushed_ = true;
+        return std::stringbuf::sync();
+    }
+
+   private:
+    TimePoint::time_point time_;
+    bool flushed_ = false;
+};
+
+// standard algebraic notation without check marks
+std::string toSan(Board &board, Move move) {
+    if (typeOf(move) == CASTLING) return to(move) > from(move) ? "O-O" : "O-O-O";
+
+    const PieceType pt = board.at<PieceType>(from(move));
+    const bool capture = board.at(to(move)) != NONE || typeOf(move) == ENPASSANT;
+    const std::string file = std::string(1, char('a' + squareFile(from(move))));
+    const std::string rank = std::string(1, char('1' + squareRank(from(move))));
+
+    std::string san;
+
+    if (pt == PAWN) {
+        if (capture) san += file;
+    } else {
+        san += char(std::toupper(PIECETYPE_TO_CHAR[pt]));
+
+        // other pieces of the same type which can move to the same square
+        Movelist moves;
+        movegen::legalmoves<Movetype::ALL>(board, moves);
+
+        bool ambiguous = false, same_file = false, same_rank = false;
+
+        for (auto extmove : moves) {
+            const Square sq = from(extmove.move);
+            if (sq == from(move) || to(extmove.move) != to(move) ||
+                board.at<PieceType>(sq) != pt || typeOf(extmove.move) == CASTLING)
+                continue;
+
+            ambiguous = true;
+            same_file |= squareFile(sq) == squareFile(from(move));
+            same_rank |= squareRank(sq) == squareRank(from(move));
+        }
+
+        if (ambiguous) san += !same_file ? file : !same_rank ? rank : file + rank;
+    }
+
+    if (capture) san += "x";
+    san += SQUARE_TO_STRING[to(move)];
+
+    if (typeOf(move) == PROMOTION) {
+        san += "=";
+        san += char(std::toupper(PIECETYPE_TO_CHAR[promotionType(move)]));
+    }
+
+    return san;
+}
+
+struct BenchResult {
     U64 nodes = 0;
+    U64 evals_saved = 0;
+    U64 acc_pushes = 0;
+    U64 acc_avoided = 0;
+    TTStats stats;
+    EvalCache::Stats eval_cache;
+    int64_t ms = 0;
+
+    [[nodiscard]] U64 nps() const { return (nodes / (ms + 1)) * 1000; }
+};
+
+BenchResult searchAll(int depth, bool tt_stats = false) {
+    BenchResult result;
 
     Limits limit;
     limit.depth = depth;
@@ -24,27 +181,389 @@ int run(int depth) {
 
         Threads.stop = false;
 
+        TTable.newSearch();
+
         std::unique_ptr<Search> searcher = std::make_unique<Search>();
 
         searcher->id = 0;
         searcher->limit = limit;
         searcher->use_tb = false;
+        searcher->collect_tt_stats = tt_stats;
         searcher->board.setFen(fen);
 
         searcher->startThinking();
 
-        nodes += searcher->nodes;
+        result.nodes += searcher->nodes;
+        result.evals_saved += searcher->evals_saved;
+        result.stats += searcher->tt_stats;
+        result.eval_cache += searcher->eval_cache.stats;
+        result.acc_pushes += searcher->board.accumulators().pushes();
+        result.acc_avoided += searcher->board.accumulators().updatesAvoided();
     }
 
     auto t2 = TimePoint::now();
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+    result.ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+
+    return result;
+}
+
+// the bench positions and every position one move away from them
+std::vector<std::string> evalPositions() {
+    std::vector<std::string> fens;
+    Board board;
+
+    for (auto &fen : benchmarkfens) {
+        board.setFen(fen, false);
+        fens.push_back(board.getFen());
+
+        Movelist moves;
+        movegen::legalmoves<Movetype::ALL>(board, moves);
+
+        for (auto extmove : moves) {
+            board.makeMove<false>(extmove.move);
+            fens.push_back(board.getFen());
+            board.unmakeMove<false>(extmove.move);
+        }
+    }
+
+    return fens;
+}
+
+}  // namespace
+
+int run(int depth, bool tt_stats) {
+    const BenchResult result = searchAll(depth, tt_stats);
+
+    std::cout << "\n" << result.evals_saved << " evaluations saved by the TT" << std::endl;
+    std::cout << result.eval_cache.hits << " of " << result.eval_cache.probes
+              << " evaluations taken from the eval cache" << std::endl;
+    std::cout << result.acc_avoided << " of " << result.acc_pushes
+              << " accumulator updates avoided" << std::endl;
+
+    if (tt_stats) std::cout << result.stats.summary() << std::endl;
 
     std::cout << "\n"
-              << nodes << " nodes " << signed((nodes / (ms + 1)) * 1000) << " nps " << std::endl;
+              << result.nodes << " nodes " << signed(result.nps()) << " nps " << std::endl;
 
     printMean();
 
     return 0;
 }
 
-}  // namespace bench
\ No newline at end of file
+int compare(const std::string &network, int depth) {
+    const std::vector<std::string> fens = evalPositions();
+    const std::string names[] = {"default", network};
+
+    std::array<BenchResult, 2> results;
+    std::array<std::vector<Score>, 2> scores;
+
+    for (int i = 0; i < 2; i++) {
+        if (!nnue::init(i == 0 ? "" : network.c_str())) {
+            nnue::init("");
+            return 1;
+        }
+
+        // both networks start from the same empty table
+        TTable.clear();
+
+        results[i] = searchAll(depth);
+
+        Board board;
+        eval::evaluate(board, fens, scores[i]);
+    }
+
+    nnue::init("");
+    TTable.clear();
+
+    int64_t error_sum = 0;
+    int max_error = 0;
+    int sign_flips = 0;
+
+    for (std::size_t i = 0; i < fens.size(); i++) {
+        const int error = std::abs(scores[1][i] - scores[0][i]);
+
+        error_sum += error;
+        max_error = std::max(max_error, error);
+        sign_flips += (scores[0][i] > 0 && scores[1][i] < 0) ||
+                      (scores[0][i] < 0 && scores[1][i] > 0);
+    }
+
+    std::cout << "\n";
+
+    for (int i = 0; i < 2; i++) {
+        std::cout << names[i] << " " << results[i].nodes << " nodes " << results[i].ms << " ms "
+                  << signed(results[i].nps()) << " nps" << std::endl;
+    }
+
+    std::cout << "speedup " << std::fixed << std::setprecision(3)
+              << double(results[1].nps()) / std::max<U64>(results[0].nps(), 1) << "\n"
+              << "eval difference over " << fens.size() << " positions: mean "
+              << std::setprecision(2) << double(error_sum) / fens.size() << " max " << max_error
+              << ", " << sign_flips << " sign changes" << std::endl;
+
+    return 0;
+}
+
+int latency(int threads, int runs) {
+    Board board;
+    board.setFen(benchmarkfens[0]);
+
+    Limits limit;
+    limit.depth = 1;
+    limit.nodes = 0;
+    limit.time = Time();
+
+    const auto micros = [](auto duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    };
+
+    int64_t first_info = 0;
+    int64_t finished = 0;
+    int64_t first_info_max = 0;
+
+    FirstLineBuffer buffer;
+    std::streambuf *console = std::cout.rdbuf(&buffer);
+
+    for (int i = 0; i < runs; i++) {
+        buffer.reset();
+
+        const auto t0 = TimePoint::now();
+
+        Threads.start(board, limit, Movelist(), threads, false);
+        Threads.wait();
+
+        const auto t1 = TimePoint::now();
+
+        const int64_t info = micros((buffer.flushed() ? buffer.time() : t1) - t0);
+        first_info += info;
+        first_info_max = std::max(first_info_max, info);
+        finished += micros(t1 - t0);
+    }
+
+    std::cout.rdbuf(console);
+    Threads.kill();
+
+    std::cout << threads << " threads " << runs << " runs, go to first info mean "
+              << first_info / std::max(runs, 1) << " us max " << first_info_max
+              << " us, go to all threads finished mean " << finished / std::max(runs, 1) << " us"
+              << std::endl;
+
+    return 0;
+}
+
+int smp(int threads, int depth) {
+    const std::pair<HelperHistory, const char *> modes[] = {
+        {HelperHistory::INHERIT, "inherit"},
+        {HelperHistory::PERSISTENT, "persistent"},
+        {HelperHistory::RESET, "reset"}};
+
+    Limits limit;
+    limit.nodes = 0;
+    limit.time = Time();
+
+    Board board;
+
+    for (const auto &[mode, name] : modes) {
+        Threads.setHelperHistory(mode);
+        Threads.clear();
+        TTable.clear();
+
+        int64_t ms = 0;
+        U64 nodes = 0;
+
+        FirstLineBuffer buffer;
+        std::streambuf *console = std::cout.rdbuf(&buffer);
+
+        for (auto &fen : benchmarkfens) {
+            board.setFen(fen);
+
+            // the search of the previous move warms up the tables of the mainthread
+            limit.depth = std::max(depth - 2, 1);
+            Threads.start(board, limit, Movelist(), threads, false);
+            Threads.wait();
+
+            limit.depth = depth;
+
+            auto t1 = TimePoint::now();
+
+            Threads.start(board, limit, Movelist(), threads, false);
+            Threads.wait();
+
+            auto t2 = TimePoint::now();
+
+            ms += std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+            nodes += Threads.getNodes();
+        }
+
+        std::cout.rdbuf(console);
+
+        std::cout << name << " " << threads << " threads time to depth " << depth << " " << ms
+                  << " ms " << nodes << " nodes" << std::endl;
+    }
+
+    Threads.kill();
+
+    return 0;
+}
+
+int solve(const std::string &epd, int threads, int movetime) {
+    struct Problem {
+        Board board;
+        std::vector<std::string> best_moves;
+    };
+
+    std::vector<Problem> problems;
+    std::ifstream file(epd);
+    std::string line;
+
+    while (std::getline(file, line)) {
+        const auto tokens = str_util::splitString(line, ' ');
+        const auto bm = std::find(tokens.begin(), tokens.end(), "bm");
+        if (tokens.size() < 4 || bm == tokens.end()) continue;
+
+        Problem problem;
+        problem.board.setFen(tokens[0] + " " + tokens[1] + " " + tokens[2] + " " + tokens[3]);
+
+        Movelist moves;
+        movegen::legalmoves<Movetype::ALL>(problem.board, moves);
+
+        for (auto it = bm + 1; it != tokens.end(); it++) {
+            std::string san = *it;
+            const bool last = san.back() == ';';
+            san.erase(std::remove_if(san.begin(), san.end(),
+                                     [](char c) { return c == ';' || c == '+' || c == '#'; }),
+                      san.end());
+
+            for (auto extmove : moves) {
+                if (toSan(problem.board, extmove.move) == san)
+                    problem.best_moves.push_back(uci::moveToUci(extmove.move, false));
+            }
+
+            if (last) break;
+        }
+
+        if (!problem.best_moves.empty()) problems.push_back(problem);
+    }
+
+    if (problems.empty()) {
+        std::cout << "no positions with a best move in " << epd << std::endl;
+        return 1;
+    }
+
+    Limits limit;
+    limit.depth = MAX_PLY - 1;
+    limit.nodes = 0;
+    limit.time.maximum = limit.time.optimum = movetime;
+
+    const bool skipping_before = Threads.depthSkipping();
+    const bool voting_before = Threads.voting();
+
+    for (bool skipping : {false, true}) {
+        for (bool voting : {false, true}) {
+            Threads.setDepthSkipping(skipping);
+            Threads.setVoting(voting);
+
+            int solved = 0;
+            int64_t total = 0;
+
+            for (auto &problem : problems) {
+                const auto correct = [&](const std::string &move) {
+                    return std::find(problem.best_moves.begin(), problem.best_moves.end(),
+                                     move) != problem.best_moves.end();
+                };
+
+                Threads.clear();
+                TTable.clear();
+
+                FirstLineBuffer buffer;
+                std::streambuf *console = std::cout.rdbuf(&buffer);
+
+                Threads.start(problem.board, limit, Movelist(), threads, false);
+                Threads.wait();
+
+                std::cout.rdbuf(console);
+
+                // time of the first info line from which on every line and the bestmove
+                // are correct
+                int64_t solved_at = -1;
+                bool solved_bestmove = false;
+                std::istringstream output(buffer.str());
+
+                while (std::getline(output, line)) {
+                    const auto tokens = str_util::splitString(line, ' ');
+                    const auto pv = std::find(tokens.begin(), tokens.end(), "pv");
+                    const bool has_pv = pv != tokens.end() && pv + 1 != tokens.end();
+
+                    if (tokens[0] == "bestmove") {
+                        solved_bestmove = correct(tokens[1]);
+                    } else if (tokens[0] == "info" && has_pv) {
+                        const auto time = str_util::findElement<int64_t>(tokens, "time");
+                        if (!correct(*(pv + 1)))
+                            solved_at = -1;
+                        else if (solved_at < 0)
+                            solved_at = time.value_or(0);
+                    }
+                }
+
+                if (solved_bestmove) {
+                    solved++;
+                    total += solved_at < 0 ? movetime : solved_at;
+                } else {
+                    total += movetime;
+                }
+            }
+
+            std::cout << "depth skipping " << (skipping ? "on " : "off") << " voting "
+                      << (voting ? "on " : "off") << " solved " << solved << "/"
+                      << problems.size() << " time to solution " << total << " ms" << std::endl;
+        }
+    }
+
+    Threads.setDepthSkipping(skipping_before);
+    Threads.setVoting(voting_before);
+    Threads.kill();
+
+    return 0;
+}
+
+int moves(int depth) {
+    const std::pair<UpdateMode, const char *> modes[] = {
+        {UpdateMode::NONE, "none"}, {UpdateMode::COPY, "copy"}, {UpdateMode::FUSED, "fused"}};
+
+    int32_t reference = 0;
+
+    for (const auto &[mode, name] : modes) {
+        U64 moves = 0;
+        int32_t checksum = 0;
+
+        auto t1 = TimePoint::now();
+
+        for (auto &fen : benchmarkfens) {
+            std::unique_ptr<MoveWalker> walker = std::make_unique<MoveWalker>();
+
+            walker->mode = mode;
+            walker->board.setFen(fen);
+            walker->board.refreshNNUE(walker->stack[0]);
+            walker->walk(0, depth);
+
+            moves += walker->moves;
+            checksum += walker->checksum;
+        }
+
+        auto t2 = TimePoint::now();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+
+        std::cout << name << " " << moves << " moves " << ms << " ms "
+                  << signed((moves / (ms + 1)) * 1000) << " moves/s" << std::endl;
+
+        if (mode == UpdateMode::COPY) reference = checksum;
+        if (mode == UpdateMode::FUSED && checksum != reference) {
+            std::cout << "fused accumulators differ from the copied ones" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+}  // namespace bench
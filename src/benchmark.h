@@ -63,6 +63,43 @@ static const std::vector<std::string> benchmarkfens = {
     "4rrb1/1kp3b1/1p1p4/pP1Pn2p/5p2/1PR2P2/2P1NB1P/2KR1B2 w D - 0 21",
     "1rkr3b/1ppn3p/3pB1n1/6q1/R2P4/4N1P1/1P5P/2KRQ1B1 b Dbd - 0 14"};
 
-int run(int depth = 12);
+/// @brief searches all bench positions and prints the total nodes and nps
+/// @param depth
+/// @param tt_stats also print the summed up TT statistics
+int run(int depth = 12, bool tt_stats = false);
+
+/// @brief searches all bench positions with the embedded network and with another one, then
+/// prints the nps of both and how much their static evaluations of the bench positions and
+/// their children differ. The embedded network is loaded again afterwards.
+/// @param network file of the other network, e.g. a quantized one
+/// @param depth
+int compare(const std::string &network, int depth = 12);
+
+/// @brief starts depth 1 searches of the first bench position with the thread pool and prints
+/// the time from go to the first info line and until every thread finished
+/// @param threads
+/// @param runs
+int latency(int threads = 1, int runs = 100);
+
+/// @brief searches every bench position to depth with the thread pool, after a search two
+/// plies shallower of the same position, for every way helpers can seed their history tables
+/// and prints the time and nodes of the deeper searches
+/// @param threads
+/// @param depth
+int smp(int threads = 8, int depth = 12);
+
+/// @brief searches every position of an EPD file with a best move (bm) for movetime ms, with
+/// and without depth skipping and voting, and prints how many positions were solved and the
+/// summed up time until the best move was found and kept, unsolved ones count as movetime
+/// @param epd
+/// @param threads
+/// @param movetime
+int solve(const std::string &epd, int threads = 8, int movetime = 1000);
+
+/// @brief plays all moves up to depth from every bench position and prints the make/unmake
+/// throughput without accumulator updates, with the parent copied into the child before the
+/// features are applied one by one, and with the child computed from the parent in one pass
+/// @param depth
+int moves(int depth = 3);
 
 }  // namespace bench
@@ -75,6 +75,34 @@ Board &Board::operator=(const Board &other) {
     return *this;
 }
 
+void Board::setPosition(const Board &other) {
+    if (this == &other) return;
+
+    chess960 = other.chess960;
+
+    state_history_ = other.state_history_;
+
+    pieces_bb_ = other.pieces_bb_;
+    board_ = other.board_;
+
+    occupancy_bb_ = other.occupancy_bb_;
+
+    hash_key_ = other.hash_key_;
+
+    castling_rights_ = other.castling_rights_;
+
+    plies_played_ = other.plies_played_;
+
+    half_move_clock_ = other.half_move_clock_;
+
+    side_to_move_ = other.side_to_move_;
+
+    en_passant_square_ = other.en_passant_square_;
+
+    accumulators_->clear();
+    refreshNNUE(getAccumulator());
+}
+
 std::string Board::getCastleString() const {
     std::stringstream ss;
 
@@ -98,21 +126,33 @@ std::string Board::getCastleString() const {
     return ss.str();
 }
 
-void Board::refreshNNUE(nnue::accumulator &acc) const {
-    for (int i = 0; i < N_HIDDEN_SIZE; i++) {
-        acc[WHITE][i] = HIDDEN_BIAS[i];
-        acc[BLACK][i] = HIDDEN_BIAS[i];
-    }
+void Board::refreshNNUE(nnue::accumulator &acc) {
+    refreshNNUE(acc, WHITE);
+    refreshNNUE(acc, BLACK);
+}
+
+void Board::refreshNNUE(nnue::accumulator &acc, Color perspective) {
+    const Square ksq = kingSq(perspective);
+    const int bucket = nnue::KING_BUCKET[perspective == WHITE ? ksq : ksq ^ 56];
+
+    RefreshCache::Entry &entry = accumulators_->refreshCache().get(perspective, bucket);
+
+    for (int p = WHITEPAWN; p <= BLACKKING; p++) {
+        const Piece piece = Piece(p);
 
-    const Square ksq_white = builtin::lsb(pieces<KING, WHITE>());
-    const Square ksq_black = builtin::lsb(pieces<KING, BLACK>());
+        Bitboard added = pieces_bb_[piece] & ~entry.pieces[piece];
+        Bitboard removed = entry.pieces[piece] & ~pieces_bb_[piece];
 
-    for (Square i = SQ_A1; i < NO_SQ; i++) {
-        Piece p = board_[i];
-        if (p == NONE) continue;
+        while (added) nnue::activate(entry.acc, perspective, builtin::poplsb(added), piece, ksq);
 
-        nnue::activate(acc, i, p, ksq_white, ksq_black);
+        while (removed) {
+            nnue::deactivate(entry.acc, perspective, builtin::poplsb(removed), piece, ksq);
+        }
+
+        entry.pieces[piece] = pieces_bb_[piece];
     }
+
+    acc[perspective] = entry.acc;
 }
 
 void Board::setFen(const std::string &fen, bool update_acc) {
@@ -151,6 +191,9 @@ void Board::setFen(const std::string &fen, bool update_acc) {
         }
     }
 
+    state_history_.clear();
+    accumulators_->clear();
+
     if (update_acc) {
         refreshNNUE(getAccumulator());
     }
@@ -186,9 +229,6 @@ void Board::setFen(const std::string &fen, bool update_acc) {
         en_passant_square_ = Square((rank - 1) * 8 + file - 1);
     }
 
-    state_history_.clear();
-    accumulators_->clear();
-
     hash_key_ = zobrist();
 }
 
@@ -250,7 +290,7 @@ std::string Board::getFen() const {
     else
         ss << " " << SQUARE_TO_STRING[en_passant_square_] << " ";
 
-    ss << halfmoves() << " " << fullMoveNumber();
+    ss << static_cast<int>(halfmoves()) << " " << fullMoveNumber();
 
     // Return the resulting FEN string
     return ss.str();
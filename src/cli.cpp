@@ -7,7 +7,9 @@
 #include "benchmark.h"
 #include "board.h"
 #include "datagen.h"
+#include "evalfile.h"
 #include "evaluation.h"
+#include "nnue.h"
 #include "perft.h"
 #include "tests/tests.h"
 #include "thread.h"
@@ -41,6 +43,18 @@ void parseDashArguments(int &i, int argc, char const *argv[],
     }
 }
 
+// arguments without a key, like file names, which come before the key=value options
+std::vector<std::string> parsePositionalArguments(int &i, int argc, char const *argv[]) {
+    std::vector<std::string> positional;
+
+    while (i + 1 < argc && argv[i + 1][0] != '-' &&
+           std::string(argv[i + 1]).find('=') == std::string::npos) {
+        positional.emplace_back(argv[++i]);
+    }
+
+    return positional;
+}
+
 class Version : public Argument {
    public:
     int parse(int &i, int, char const *[]) override {
@@ -99,6 +113,75 @@ class Eval : public Argument {
     }
 };
 
+class EvalFile : public Argument {
+   public:
+    int parse(int &i, int argc, char const *argv[]) override {
+        std::vector<std::string> files = parsePositionalArguments(i, argc, argv);
+        int threads = 1;
+
+        parseDashArguments(i, argc, argv, [&](const std::string &key, const std::string &value) {
+            if (key == "threads") {
+                threads = std::stoi(value);
+            } else {
+                ArgumentsParser::throwMissing("evalfile", key, value);
+            }
+        });
+
+        if (files.size() != 2) {
+            std::cout << "Usage: -evalfile <input> <output> threads=<threads>" << std::endl;
+            return 1;
+        }
+
+        evalfile::run(files[0], files[1], threads);
+        return 1;
+    }
+};
+
+class ConvertNet : public Argument {
+   public:
+    int parse(int &i, int argc, char const *argv[]) override {
+        std::vector<std::string> files = parsePositionalArguments(i, argc, argv);
+        int hidden = DEFAULT_HIDDEN_SIZE;
+
+        parseDashArguments(i, argc, argv, [&](const std::string &key, const std::string &value) {
+            if (key == "hidden") {
+                hidden = std::stoi(value);
+            } else {
+                ArgumentsParser::throwMissing("convertnet", key, value);
+            }
+        });
+
+        if (files.size() != 2) {
+            std::cout << "Usage: -convertnet <input> <output> hidden=<hidden size>" << std::endl;
+            return 1;
+        }
+
+        if (nnue::convert(files[0], files[1], hidden)) {
+            std::cout << "Wrote " << files[1] << std::endl;
+        }
+
+        return 1;
+    }
+};
+
+class QuantizeNet : public Argument {
+   public:
+    int parse(int &i, int argc, char const *argv[]) override {
+        std::vector<std::string> files = parsePositionalArguments(i, argc, argv);
+
+        if (files.size() != 2) {
+            std::cout << "Usage: -quantizenet <input> <output>" << std::endl;
+            return 1;
+        }
+
+        if (nnue::quantize(files[0], files[1])) {
+            std::cout << "Wrote " << files[1] << std::endl;
+        }
+
+        return 1;
+    }
+};
+
 class See : public Argument {
    public:
     int parse(int &i, int argc, char const *argv[]) override {
@@ -124,15 +207,121 @@ class See : public Argument {
 
 class Benchmark : public Argument {
    public:
-    int parse(int &, int, char const *argv[]) override {
+    int parse(int &i, int argc, char const *argv[]) override {
+        int depth = 12;
+        bool tt_stats = false;
+        std::string network;
+
+        parseDashArguments(i, argc, argv, [&](const std::string &key, const std::string &value) {
+            if (key == "depth") {
+                depth = std::stoi(value);
+            } else if (key == "ttstats") {
+                tt_stats = value == "true";
+            } else if (key == "compare") {
+                network = value;
+            } else {
+                ArgumentsParser::throwMissing("bench", key, value);
+            }
+        });
+
         if (std::string(argv[1]) == std::string("bench")) {
-            bench::run(12);
+            if (network.empty())
+                bench::run(depth, tt_stats);
+            else
+                bench::compare(network, depth);
             return 1;
         }
         return 0;
     }
 };
 
+class MoveBenchmark : public Argument {
+   public:
+    int parse(int &i, int argc, char const *argv[]) override {
+        int depth = 3;
+
+        parseDashArguments(i, argc, argv, [&](const std::string &key, const std::string &value) {
+            if (key == "depth") {
+                depth = std::stoi(value);
+            } else {
+                ArgumentsParser::throwMissing("movebench", key, value);
+            }
+        });
+
+        bench::moves(depth);
+        return 1;
+    }
+};
+
+class GoBenchmark : public Argument {
+   public:
+    int parse(int &i, int argc, char const *argv[]) override {
+        int threads = 1;
+        int runs = 100;
+
+        parseDashArguments(i, argc, argv, [&](const std::string &key, const std::string &value) {
+            if (key == "threads") {
+                threads = std::stoi(value);
+            } else if (key == "runs") {
+                runs = std::stoi(value);
+            } else {
+                ArgumentsParser::throwMissing("gobench", key, value);
+            }
+        });
+
+        bench::latency(threads, runs);
+        return 1;
+    }
+};
+
+class SmpBenchmark : public Argument {
+   public:
+    int parse(int &i, int argc, char const *argv[]) override {
+        int threads = 8;
+        int depth = 12;
+
+        parseDashArguments(i, argc, argv, [&](const std::string &key, const std::string &value) {
+            if (key == "threads") {
+                threads = std::stoi(value);
+            } else if (key == "depth") {
+                depth = std::stoi(value);
+            } else {
+                ArgumentsParser::throwMissing("smpbench", key, value);
+            }
+        });
+
+        bench::smp(threads, depth);
+        return 1;
+    }
+};
+
+class Solve : public Argument {
+   public:
+    int parse(int &i, int argc, char const *argv[]) override {
+        std::vector<std::string> files = parsePositionalArguments(i, argc, argv);
+        int threads = 8;
+        int movetime = 1000;
+
+        parseDashArguments(i, argc, argv, [&](const std::string &key, const std::string &value) {
+            if (key == "threads") {
+                threads = std::stoi(value);
+            } else if (key == "movetime") {
+                movetime = std::stoi(value);
+            } else {
+                ArgumentsParser::throwMissing("solve", key, value);
+            }
+        });
+
+        if (files.size() != 1) {
+            std::cout << "Usage: -solve <epd> threads=<threads> movetime=<ms>" << std::endl;
+            return 1;
+        }
+
+        bench::solve(files[0], threads, movetime);
+        return 1;
+    }
+};
+
 class Generate : public Argument {
    public:
     int parse(int &i, int argc, char const *argv[]) override {
@@ -157,7 +346,7 @@ class Generate : public Argument {
             }
         });
 
-        TTable.allocateMB(hash_ * workers_);
+        TTable.allocateMB(hash_ * workers_, workers_);
 
         datagen_.generate(workers_, book_path_, depth_, nodes_, use_tb_);
 
@@ -170,7 +359,7 @@ class Generate : public Argument {
             }
 
             if (input == "quit") {
-                Threads.stop = true;
+                Threads.stopSearch();
 
                 return 1;
             }
@@ -198,12 +387,19 @@ class TestRunner : public Argument {
 
 ArgumentsParser::ArgumentsParser() {
     addArgument("-eval", new Eval());
+    addArgument("-evalfile", new EvalFile());
+    addArgument("-convertnet", new ConvertNet());
+    addArgument("-quantizenet", new QuantizeNet());
     addArgument("perft", new Perft());
     addArgument("-version", new Version());
     addArgument("--version", new Version());
     addArgument("-v", new Version());
     addArgument("--v", new Version());
     addArgument("bench", new Benchmark());
+    addArgument("movebench", new MoveBenchmark());
+    addArgument("gobench", new GoBenchmark());
+    addArgument("smpbench", new SmpBenchmark());
+    addArgument("-solve", new Solve());
     addArgument("-see", new See());
     addArgument("-generate", new Generate());
     addArgument("-tests", new TestRunner());
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "evalfile.h"
+#include "evaluation.h"
+
+namespace evalfile {
+
+namespace {
+
+// positions every thread evaluates before the results are written
+constexpr std::size_t BLOCK_PER_THREAD = 16384;
+
+bool isNumber(const std::string &str) {
+    return !str.empty() && std::all_of(str.begin(), str.end(), ::isdigit);
+}
+
+/// @brief checks the board and side to move fields, setFen does not validate its input
+bool validPlacement(const std::string &placement) {
+    int ranks = 1;
+    int files = 0;
+    int kings[2] = {};
+
+    for (char c : placement) {
+        if (c == '/') {
+            if (files != 8) return false;
+            ranks++;
+            files = 0;
+        } else if (c >= '1' && c <= '8') {
+            files += c - '0';
+        } else if (std::string("pnbrqkPNBRQK").find(c) != std::string::npos) {
+            kings[0] += c == 'K';
+            kings[1] += c == 'k';
+            files++;
+        } else {
+            return false;
+        }
+
+        if (files > 8) return false;
+    }
+
+    return ranks == 8 && files == 8 && kings[0] == 1 && kings[1] == 1;
+}
+
+/// @brief the fen at the start of a line, empty if there is none
+std::string extractFen(const std::string &line) {
+    std::istringstream stream(line);
+    std::vector<std::string> fields;
+
+    // a whitespace split also drops the carriage return of windows line endings
+    for (std::string field; fields.size() < 6 && stream >> field;) fields.emplace_back(field);
+
+    if (fields.size() < 4 || !validPlacement(fields[0]) ||
+        (fields[1] != "w" && fields[1] != "b")) {
+        return "";
+    }
+
+    std::string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+
+    // the move counters are optional, EPD records carry operations instead
+    for (std::size_t i = 4; i < 6 && i < fields.size() && isNumber(fields[i]); i++) {
+        fen += " " + fields[i];
+    }
+
+    return fen;
+}
+
+}  // namespace
+
+int run(const std::string &input, const std::string &output, int threads) {
+    std::ifstream in(input);
+    std::ofstream out(output);
+
+    if (!in.is_open()) {
+        std::cout << "Could not open " << input << std::endl;
+        return 1;
+    }
+
+    if (!out.is_open()) {
+        std::cout << "Could not open " << output << std::endl;
+        return 1;
+    }
+
+    threads = std::max(threads, 1);
+
+    std::vector<Board> boards(threads);
+    std::vector<std::vector<std::string>> fens(threads);
+    std::vector<std::vector<Score>> scores(threads);
+
+    U64 positions = 0;
+    U64 skipped = 0;
+    bool eof = false;
+
+    auto t1 = TimePoint::now();
+
+    while (!eof) {
+        // every thread gets a contiguous part of the block so the output keeps the input order
+        for (int t = 0; t < threads; t++) {
+            fens[t].clear();
+
+            std::string line;
+            while (fens[t].size() < BLOCK_PER_THREAD && !(eof = !std::getline(in, line))) {
+                std::string fen = extractFen(line);
+
+                if (fen.empty()) {
+                    skipped += !line.empty();
+                    continue;
+                }
+
+                fens[t].emplace_back(std::move(fen));
+            }
+        }
+
+        std::vector<std::thread> workers;
+
+        for (int t = 1; t < threads; t++) {
+            workers.emplace_back([&, t]() { eval::evaluate(boards[t], fens[t], scores[t]); });
+        }
+
+        eval::evaluate(boards[0], fens[0], scores[0]);
+
+        for (auto &worker : workers) worker.join();
+
+        for (int t = 0; t < threads; t++) {
+            for (std::size_t i = 0; i < fens[t].size(); i++) {
+                out << fens[t][i] << " " << scores[t][i] << "\n";
+            }
+
+            positions += fens[t].size();
+        }
+    }
+
+    out.flush();
+
+    auto t2 = TimePoint::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+
+    std::cout << positions << " positions evaluated, " << skipped << " lines skipped" << std::endl;
+    std::cout << ms << " ms " << signed((positions / (ms + 1)) * 1000) << " positions/s"
+              << std::endl;
+
+    return 0;
+}
+
+}  // namespace evalfile
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+namespace evalfile {
+
+/// @brief reads one position per line from input and writes "<fen> <score>" lines to output,
+/// the score is the static evaluation from the side to move. Lines may be EPD records or
+/// positions followed by other data, only the fen at the start is used and lines without a
+/// valid position are skipped.
+/// @param input
+/// @param output
+/// @param threads number of threads which evaluate a block of positions at once
+/// @return 1 if one of the files could not be opened
+int run(const std::string &input, const std::string &output, int threads = 1);
+
+}  // namespace evalfile
@@ -4,12 +4,65 @@
 #include "nnue.h"
 
 namespace eval {
-Score evaluate(Board &board) {
-    int32_t v = nnue::output(board.getAccumulator(), board.sideToMove());
 
-    v = static_cast<double>(v) * (1.0 - (board.halfmoves() / 1000.0));
+namespace {
+
+// accumulators which are refreshed before their outputs are computed, 128 KiB stay in L2
+constexpr std::size_t BATCH_CHUNK = 64;
+
+}  // namespace
+
+Score scale(int32_t v, int halfmoves) {
+    v = static_cast<double>(v) * (1.0 - (halfmoves / 1000.0));
     Score score = std::clamp(static_cast<int>(v), (int32_t)(VALUE_MATED_IN_PLY + 1),
                              (int32_t)(VALUE_MATE_IN_PLY - 1));
     return score;
 }
-}  // namespace eval
\ No newline at end of file
+
+Score evaluate(Board &board) {
+    return scale(nnue::output(board.getAccumulator(), board.sideToMove()), board.halfmoves());
+}
+
+Score rawEvaluate(Board &board, EvalCache &cache) {
+    int32_t v;
+
+    if (!cache.probe(board.hash(), v)) {
+        v = nnue::output(board.getAccumulator(), board.sideToMove());
+        cache.store(board.hash(), v);
+    }
+
+    return scale(v, 0);
+}
+
+Score evaluate(Board &board, EvalCache &cache) {
+    return scale(rawEvaluate(board, cache), board.halfmoves());
+}
+
+void evaluate(Board &board, const std::vector<std::string> &fens, std::vector<Score> &scores) {
+    std::vector<nnue::accumulator> accumulators(std::min(fens.size(), BATCH_CHUNK));
+    std::array<Color, BATCH_CHUNK> side_to_move;
+    std::array<int, BATCH_CHUNK> halfmoves;
+
+    scores.resize(fens.size());
+
+    for (std::size_t start = 0; start < fens.size(); start += BATCH_CHUNK) {
+        const std::size_t count = std::min(fens.size() - start, BATCH_CHUNK);
+
+        for (std::size_t i = 0; i < count; i++) {
+            board.setFen(fens[start + i], false);
+            board.refreshNNUE(accumulators[i]);
+
+            side_to_move[i] = board.sideToMove();
+            halfmoves[i] = board.halfmoves();
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            scores[start + i] = scale(nnue::output(accumulators[i], side_to_move[i]), halfmoves[i]);
+        }
+    }
+
+    // the board is left in the last position with a valid accumulator
+    if (!fens.empty()) board.refreshNNUE(board.getAccumulator());
+}
+
+}  // namespace eval
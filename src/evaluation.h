@@ -1,9 +1,38 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "board.h"
+#include "types/eval_cache.h"
 
 namespace eval {
 
 [[nodiscard]] Score evaluate(Board &board);
 
-}  // namespace eval
\ No newline at end of file
+/// @brief evaluate() which looks up the network output in the cache first
+/// @param board
+/// @param cache eval cache of the searching thread
+[[nodiscard]] Score evaluate(Board &board, EvalCache &cache);
+
+/// @brief evaluate() without the halfmove scaling, which is not part of the hash.
+/// This is the value cached in the TT, scale() turns it into the evaluation.
+/// @param board
+/// @param cache eval cache of the searching thread
+[[nodiscard]] Score rawEvaluate(Board &board, EvalCache &cache);
+
+/// @brief scale a raw evaluation down as the halfmove clock approaches the 50 move rule
+/// and clamp it to the range of static evaluations
+/// @param v
+/// @param halfmoves
+[[nodiscard]] Score scale(int32_t v, int halfmoves);
+
+/// @brief static evaluation of many positions from the side to move, scored like evaluate().
+/// The accumulators are refreshed through the refresh cache of one board, so similar positions
+/// only apply the pieces which differ, then the output layer runs over the whole batch.
+/// @param board sets up the positions, its position is overwritten
+/// @param fens
+/// @param scores resized to the number of fens
+void evaluate(Board &board, const std::vector<std::string> &fens, std::vector<Score> &scores);
+
+}  // namespace eval
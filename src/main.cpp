@@ -3,7 +3,7 @@
 #include "cli.h"
 
 // Transposition Table
-// Each entry is 14 bytes large
+// Each cluster fills one cache line, see TCluster
 TranspositionTable TTable{};
 ThreadPool Threads;
 
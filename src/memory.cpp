@@ -0,0 +1,180 @@
+#include "memory.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace memory {
+
+#if defined(_WIN32)
+
+constexpr std::size_t ALIGNMENT = 4096;
+
+Block allocLargePages(std::size_t size) {
+    Block block;
+    block.size = size;
+    block.ptr = _aligned_malloc(size, ALIGNMENT);
+    return block;
+}
+
+Block mapFile(const std::string &path, bool) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (!file) return Block();
+
+    const std::size_t size = file.tellg();
+    file.seekg(0);
+
+    Block block = allocLargePages(size);
+
+    if (block.ptr != nullptr && !file.read(static_cast<char *>(block.ptr), size)) free(block);
+
+    return block;
+}
+
+Block mapShared(const std::string &, std::size_t, bool &created) {
+    created = false;
+    return Block();
+}
+
+void unlinkShared(const std::string &) {}
+
+void free(Block &block) {
+    _aligned_free(block.ptr);
+    block = Block();
+}
+
+#else
+
+constexpr std::size_t ALIGNMENT = 2 * 1024 * 1024;
+
+Block allocLargePages(std::size_t size) {
+    Block block;
+
+    // round up to a multiple of the huge page size
+    block.size = ((size + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+
+#if defined(MAP_HUGETLB)
+    void *mem = mmap(nullptr, block.size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (mem != MAP_FAILED) {
+        block.ptr = mem;
+        block.mapped = true;
+        block.huge_pages = true;
+        return block;
+    }
+#endif
+
+    if (posix_memalign(&block.ptr, ALIGNMENT, block.size) != 0) {
+        block = Block();
+        return block;
+    }
+
+#if defined(MADV_HUGEPAGE)
+    block.huge_pages = madvise(block.ptr, block.size, MADV_HUGEPAGE) == 0;
+#endif
+
+    return block;
+}
+
+Block mapFile(const std::string &path, bool sequential) {
+    Block block;
+
+    const int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd == -1) return block;
+
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mem != MAP_FAILED) {
+            block.ptr = mem;
+            block.size = st.st_size;
+            block.mapped = true;
+
+#if defined(MADV_SEQUENTIAL)
+            if (sequential) madvise(block.ptr, block.size, MADV_SEQUENTIAL);
+#endif
+        }
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+
+    return block;
+}
+
+namespace {
+std::string sharedName(const std::string &name) {
+    return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+}  // namespace
+
+Block mapShared(const std::string &name, std::size_t size, bool &created) {
+    Block block;
+
+    int fd = shm_open(sharedName(name).c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    created = fd != -1;
+
+    if (created && ftruncate(fd, size) != 0) {
+        close(fd);
+        unlinkShared(name);
+        return block;
+    }
+
+    if (!created && errno == EEXIST) fd = shm_open(sharedName(name).c_str(), O_RDWR, 0600);
+
+    if (fd == -1) return block;
+
+    struct stat st;
+    st.st_size = 0;
+
+    // the creator might not have set the size yet
+    for (int i = 0; i < 1000 && fstat(fd, &st) == 0 && st.st_size == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (st.st_size > 0) {
+        void *mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (mem != MAP_FAILED) {
+            block.ptr = mem;
+            block.size = st.st_size;
+            block.mapped = true;
+        }
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+
+    return block;
+}
+
+void unlinkShared(const std::string &name) { shm_unlink(sharedName(name).c_str()); }
+
+void free(Block &block) {
+    if (block.mapped)
+        munmap(block.ptr, block.size);
+    else
+        std::free(block.ptr);
+
+    block = Block();
+}
+
+#endif
+
+}  // namespace memory
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace memory {
+
+// A block of memory which is aligned to a page boundary
+struct Block {
+    void *ptr = nullptr;
+    std::size_t size = 0;
+
+    // allocated with mmap and has to be released with munmap
+    bool mapped = false;
+
+    // backed by explicit or transparent huge pages
+    bool huge_pages = false;
+};
+
+/// @brief allocate a page aligned block of at least size bytes, tries explicit huge pages
+/// (MAP_HUGETLB) first and falls back to aligned memory advised for transparent huge pages.
+/// @param size
+/// @return block.ptr is nullptr on failure
+[[nodiscard]] Block allocLargePages(std::size_t size);
+
+/// @brief map a file read-only into memory, on systems without mmap the file is read into
+/// an aligned buffer instead
+/// @param path
+/// @param sequential the file is read once from start to end, pages can be dropped early
+/// @return block.ptr is nullptr on failure
+[[nodiscard]] Block mapFile(const std::string &path, bool sequential = true);
+
+/// @brief open the named shared memory segment and map it read-write. The segment is created
+/// with size bytes if it does not exist yet, an existing one is mapped with its own size.
+/// Only available on POSIX systems.
+/// @param name segment name, a leading '/' is added if missing
+/// @param size
+/// @param created set to true if this call created the segment
+/// @return block.ptr is nullptr on failure
+[[nodiscard]] Block mapShared(const std::string &name, std::size_t size, bool &created);
+
+/// @brief remove a segment created by mapShared, existing mappings stay valid
+/// @param name
+void unlinkShared(const std::string &name);
+
+/// @brief release a block returned by allocLargePages, mapFile or mapShared
+/// @param block
+void free(Block &block);
+
+}  // namespace memory
@@ -1,7 +1,12 @@
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <vector>
 
+#include "memory.h"
 #include "nnue.h"
+#include "simd.h"
 
 #define INCBIN_STYLE INCBIN_STYLE_CAMEL
 
@@ -9,13 +14,63 @@
 
 INCBIN(Eval, EVALFILE);
 
-alignas(32) int16_t INPUT_WEIGHTS[BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE];
-alignas(32) int16_t HIDDEN_BIAS[N_HIDDEN_SIZE];
-alignas(32) int16_t HIDDEN_WEIGHTS[N_HIDDEN_SIZE * 2];
-alignas(32) int32_t OUTPUT_BIAS[OUTPUTS];
+const int16_t *INPUT_WEIGHTS = nullptr;
+const int8_t *INPUT_WEIGHTS_INT8 = nullptr;
+const int16_t *HIDDEN_BIAS = nullptr;
+const int16_t *HIDDEN_WEIGHTS = nullptr;
+const int32_t *OUTPUT_BIAS = nullptr;
 
 namespace nnue {
 
+    // pointers to the parts of a network, laid out as in a network file. A quantized network
+    // has int8 input weights, its accumulators are scaled down by 2^input_shift.
+    struct Weights {
+        const int16_t *input_weights = nullptr;
+        const int8_t *input_weights_int8 = nullptr;
+        const int16_t *hidden_bias = nullptr;
+        const int16_t *hidden_weights = nullptr;
+        const int32_t *output_bias = nullptr;
+        int hidden_size = 0;
+        int input_shift = 0;
+    };
+
+    Weights weightsAt(const unsigned char *data, const NetworkHeader &header) {
+        const std::size_t inputs = std::size_t(BUCKETS) * FEATURE_SIZE * header.hidden;
+
+        Weights weights;
+        weights.hidden_size = header.hidden;
+        weights.input_shift = header.input_shift;
+
+        if (header.input_bits == 8) {
+            weights.input_weights_int8 = reinterpret_cast<const int8_t *>(data);
+            weights.hidden_bias = reinterpret_cast<const int16_t *>(data + inputs);
+        } else {
+            weights.input_weights = reinterpret_cast<const int16_t *>(data);
+            weights.hidden_bias = weights.input_weights + inputs;
+        }
+
+        weights.hidden_weights = weights.hidden_bias + header.hidden;
+        // every supported hidden size keeps the offset a multiple of 4
+        weights.output_bias =
+                reinterpret_cast<const int32_t *>(weights.hidden_weights + 2 * header.hidden);
+        return weights;
+    }
+
+    // mapping of the loaded network file, empty while the embedded network is used
+    memory::Block network_file;
+
+    int hidden_size = DEFAULT_HIDDEN_SIZE;
+    int input_shift = 0;
+
+    // calls func with the update kernels and the input weights of the loaded network
+    template<typename Func>
+    void withInputWeights(Func &&func) {
+        if (INPUT_WEIGHTS_INT8 != nullptr)
+            func(simd::active.weights8, INPUT_WEIGHTS_INT8);
+        else
+            func(simd::active.weights16, INPUT_WEIGHTS);
+    }
+
     template<Color side>
     int idx(Square sq, Piece p, int ksq) {
         if constexpr (side == WHITE) {
@@ -29,39 +84,32 @@ namespace nnue {
         }
     }
 
+    int idx(Color perspective, Square sq, Piece p, Square ksq) {
+        return perspective == WHITE ? idx<WHITE>(sq, p, ksq) : idx<BLACK>(sq, p, ksq);
+    }
+
+    uint32_t network_version = 0;
+
     void activate(nnue::accumulator &accumulator, Square sq, Piece p, Square ksq_white,
                   Square ksq_black) {
         const int input_white = idx<WHITE>(sq, p, ksq_white);
         const int input_black = idx<BLACK>(sq, p, ksq_black);
 
-        for (int chunks = 0; chunks < N_HIDDEN_SIZE / 256; chunks++) {
-            const int offset = chunks * 256;
-
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[0][i] += INPUT_WEIGHTS[input_white * N_HIDDEN_SIZE + i];
-            }
-
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[1][i] += INPUT_WEIGHTS[input_black * N_HIDDEN_SIZE + i];
-            }
-        }
+        withInputWeights([&](const auto &kernels, const auto *weights) {
+            kernels.add(accumulator[0].data(), &weights[input_white * hidden_size]);
+            kernels.add(accumulator[1].data(), &weights[input_black * hidden_size]);
+        });
     }
 
     void deactivate(nnue::accumulator &accumulator, Square sq, Piece p, Square ksq_white,
                     Square ksq_black) {
         const int input_white = idx<WHITE>(sq, p, ksq_white);
         const int input_black = idx<BLACK>(sq, p, ksq_black);
-        for (int chunks = 0; chunks < N_HIDDEN_SIZE / 256; chunks++) {
-            const int offset = chunks * 256;
 
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[0][i] -= INPUT_WEIGHTS[input_white * N_HIDDEN_SIZE + i];
-            }
-
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[1][i] -= INPUT_WEIGHTS[input_black * N_HIDDEN_SIZE + i];
-            }
-        }
+        withInputWeights([&](const auto &kernels, const auto *weights) {
+            kernels.sub(accumulator[0].data(), &weights[input_white * hidden_size]);
+            kernels.sub(accumulator[1].data(), &weights[input_black * hidden_size]);
+        });
     }
 
     void move(nnue::accumulator &accumulator, Square from_sq, Square to_sq, Piece p, Square ksq_white,
@@ -72,79 +120,340 @@ namespace nnue {
         const int input_clear_black = idx<BLACK>(from_sq, p, ksq_black);
         const int input_add_black = idx<BLACK>(to_sq, p, ksq_black);
 
-        for (int chunks = 0; chunks < N_HIDDEN_SIZE / 256; chunks++) {
-            const int offset = chunks * 256;
+        withInputWeights([&](const auto &kernels, const auto *weights) {
+            kernels.addSub(accumulator[0].data(), &weights[input_add_white * hidden_size],
+                           &weights[input_clear_white * hidden_size]);
+            kernels.addSub(accumulator[1].data(), &weights[input_add_black * hidden_size],
+                           &weights[input_clear_black * hidden_size]);
+        });
+    }
 
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[0][i] += -INPUT_WEIGHTS[input_clear_white * N_HIDDEN_SIZE + i] +
-                                     INPUT_WEIGHTS[input_add_white * N_HIDDEN_SIZE + i];
-            }
+    void activate(nnue::perspective_accumulator &accumulator, Color perspective, Square sq, Piece p,
+                  Square ksq) {
+        withInputWeights([&](const auto &kernels, const auto *weights) {
+            kernels.add(accumulator.data(), &weights[idx(perspective, sq, p, ksq) * hidden_size]);
+        });
+    }
+
+    void deactivate(nnue::perspective_accumulator &accumulator, Color perspective, Square sq,
+                    Piece p, Square ksq) {
+        withInputWeights([&](const auto &kernels, const auto *weights) {
+            kernels.sub(accumulator.data(), &weights[idx(perspective, sq, p, ksq) * hidden_size]);
+        });
+    }
 
-            for (int i = offset; i < 256 + offset; i++) {
-                accumulator[1][i] += -INPUT_WEIGHTS[input_clear_black * N_HIDDEN_SIZE + i] +
-                                     INPUT_WEIGHTS[input_add_black * N_HIDDEN_SIZE + i];
+    void move(nnue::perspective_accumulator &accumulator, Color perspective, Square from_sq,
+              Square to_sq, Piece p, Square ksq) {
+        withInputWeights([&](const auto &kernels, const auto *weights) {
+            kernels.addSub(accumulator.data(),
+                           &weights[idx(perspective, to_sq, p, ksq) * hidden_size],
+                           &weights[idx(perspective, from_sq, p, ksq) * hidden_size]);
+        });
+    }
+
+    void update(const nnue::perspective_accumulator &in, nnue::perspective_accumulator &out,
+                Color perspective, Square ksq, const Feature *added, int added_count,
+                const Feature *removed, int removed_count) {
+        withInputWeights([&](const auto &kernels, const auto *weights) {
+            const auto row = [&](const Feature &f) {
+                return &weights[idx(perspective, f.sq, f.piece, ksq) * hidden_size];
+            };
+
+            if (added_count == 1 && removed_count == 1) {
+                kernels.add1Sub1(out.data(), in.data(), row(added[0]), row(removed[0]));
+            } else if (added_count == 1 && removed_count == 2) {
+                kernels.add1Sub2(out.data(), in.data(), row(added[0]), row(removed[0]),
+                                 row(removed[1]));
+            } else if (added_count == 2 && removed_count == 2) {
+                kernels.add2Sub2(out.data(), in.data(), row(added[0]), row(added[1]),
+                                 row(removed[0]), row(removed[1]));
+            } else {
+                out = in;
+
+                for (int i = 0; i < added_count; i++) kernels.add(out.data(), row(added[i]));
+                for (int i = 0; i < removed_count; i++) kernels.sub(out.data(), row(removed[i]));
             }
-        }
+        });
     }
 
+    uint32_t networkVersion() { return network_version; }
+
     int16_t relu(int16_t x) { return std::max(static_cast<int16_t>(0), x); }
 
     int32_t output(const nnue::accumulator &accumulator, Color side) {
-        int32_t output = OUTPUT_BIAS[0];
+        int32_t hidden = simd::active.dotRelu(accumulator[static_cast<int>(side)].data(),
+                                              HIDDEN_WEIGHTS);
+        hidden += simd::active.dotRelu(accumulator[static_cast<int>(~side)].data(),
+                                       &HIDDEN_WEIGHTS[hidden_size]);
 
-        for (int chunks = 0; chunks < N_HIDDEN_SIZE / 256; chunks++) {
-            const int offset = chunks * 256;
+        // relu commutes with the scaling of a quantized network
+        const int32_t output = OUTPUT_BIAS[0] + hidden * (1 << input_shift);
 
-            // two individual loops seem to be faster for auto vectorization
-            for (int i = 0; i < 256; i++) {
-                output +=
-                        relu(accumulator[static_cast<int>(side)][i + offset]) * HIDDEN_WEIGHTS[i + offset];
-            }
+        return output / (16 * 512);
+    }
+
+    template<typename T>
+    uint64_t hashArray(uint64_t hash, const T *array, std::size_t size) {
+        // FNV-1a over the elements
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= static_cast<uint64_t>(array[i]);
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    uint64_t hashWeights(const Weights &weights) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        const std::size_t inputs = std::size_t(BUCKETS) * FEATURE_SIZE * weights.hidden_size;
 
-            for (int i = 0; i < 256; i++) {
-                output += relu(accumulator[static_cast<int>(~side)][i + offset]) *
-                          HIDDEN_WEIGHTS[N_HIDDEN_SIZE + i + offset];
+        if (weights.input_weights_int8 != nullptr)
+            hash = hashArray(hash, weights.input_weights_int8, inputs);
+        else
+            hash = hashArray(hash, weights.input_weights, inputs);
+
+        hash = hashArray(hash, weights.hidden_bias, weights.hidden_size);
+        hash = hashArray(hash, weights.hidden_weights, 2 * weights.hidden_size);
+        hash = hashArray(hash, weights.output_bias, OUTPUTS);
+
+        return hash;
+    }
+
+    Weights active() {
+        Weights weights;
+        weights.input_weights = INPUT_WEIGHTS;
+        weights.input_weights_int8 = INPUT_WEIGHTS_INT8;
+        weights.hidden_bias = HIDDEN_BIAS;
+        weights.hidden_weights = HIDDEN_WEIGHTS;
+        weights.output_bias = OUTPUT_BIAS;
+        weights.hidden_size = hidden_size;
+        weights.input_shift = input_shift;
+        return weights;
+    }
+
+    uint64_t networkHash() { return hashWeights(active()); }
+
+    int hiddenSize() { return hidden_size; }
+
+    bool quantized() { return INPUT_WEIGHTS_INT8 != nullptr; }
+
+    // finds the weights in a network file, files without a header are of the default architecture
+    bool parse(const unsigned char *data, std::size_t size, Weights &weights, std::string &error) {
+        NetworkHeader header;
+
+        if (size < sizeof(header) ||
+            std::memcmp(data, &NetworkHeader::MAGIC, sizeof(NetworkHeader::MAGIC)) != 0) {
+            if (size != header.weightsSize()) {
+                error = "no header and not the size of the default network";
+                return false;
             }
+
+            weights = weightsAt(data, header);
+            return true;
         }
 
-        return output / (16 * 512);
+        std::memcpy(&header, data, sizeof(header));
+
+        if (header.version == 1) {
+            header.input_bits = 16;
+            header.input_shift = 0;
+        } else if (header.version != NetworkHeader::VERSION) {
+            error = "format version " + std::to_string(header.version) + " is not supported";
+            return false;
+        }
+
+        if (header.buckets != BUCKETS || header.features != FEATURE_SIZE ||
+            header.outputs != OUTPUTS || !simd::supportedHiddenSize(header.hidden) ||
+            (header.input_bits != 16 && header.input_bits != 8) || header.input_shift > 8) {
+            error = "architecture " + std::to_string(header.features) + "x" +
+                    std::to_string(header.buckets) + "->" + std::to_string(header.hidden) +
+                    "x2->" + std::to_string(header.outputs) + " with " +
+                    std::to_string(header.input_bits) + " bit input weights is not supported";
+            return false;
+        }
+
+        if (size != sizeof(header) + header.weightsSize()) {
+            error = "the size does not match the architecture";
+            return false;
+        }
+
+        weights = weightsAt(data + sizeof(header), header);
+
+        if (hashWeights(weights) != header.hash) {
+            error = "the hash does not match, the file is corrupt";
+            return false;
+        }
+
+        return true;
     }
 
-    void init(const char *filename) {
-        FILE *f = fopen(filename, "rb");
+    bool write(const std::string &filename, const Weights &weights) {
+        NetworkHeader header;
+        header.hidden = weights.hidden_size;
+        header.hash = hashWeights(weights);
+        header.input_bits = weights.input_weights_int8 != nullptr ? 8 : 16;
+        header.input_shift = weights.input_shift;
+
+        const char *data = weights.input_weights_int8 != nullptr
+                                   ? reinterpret_cast<const char *>(weights.input_weights_int8)
+                                   : reinterpret_cast<const char *>(weights.input_weights);
 
-        // obtain file size
-        std::size_t fileSize = FEATURE_SIZE * N_HIDDEN_SIZE + N_HIDDEN_SIZE + 2 * N_HIDDEN_SIZE + OUTPUTS;
+        std::ofstream file(filename, std::ios::binary);
+
+        // the parts are contiguous in memory, as in the file
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(data, header.weightsSize());
+
+        if (!file) {
+            std::cout << "info string could not write " << filename << std::endl;
+            return false;
+        }
 
-        std::size_t readElements = 0;
-        if (f != nullptr) {
-            readElements +=
-                    fread(INPUT_WEIGHTS, sizeof(int16_t), BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE, f);
-            readElements += fread(HIDDEN_BIAS, sizeof(int16_t), N_HIDDEN_SIZE, f);
-            readElements += fread(HIDDEN_WEIGHTS, sizeof(int16_t), 2 * N_HIDDEN_SIZE, f);
-            readElements += fread(OUTPUT_BIAS, sizeof(int32_t), OUTPUTS, f);
+        return true;
+    }
 
-            if (readElements != fileSize) {
-                std::cout << "The network was not fully loaded"
-                          << " " << readElements << " " << fileSize << std::endl;
-                exit(2);
+    bool init(const char *filename) {
+        memory::Block block;
+        Weights weights;
+        std::string error;
+
+        if (filename[0] != '\0') {
+            // searches read the weights from the mapping, the pages must not be dropped early
+            block = memory::mapFile(filename, false);
+
+            if (block.ptr == nullptr) {
+                std::cout << "info string could not open " << filename
+                          << ", using the embedded network" << std::endl;
+            } else if (!parse(static_cast<const unsigned char *>(block.ptr), block.size, weights,
+                              error)) {
+                std::cout << "info string rejected " << filename << ": " << error << std::endl;
+                memory::free(block);
+
+                // keep the loaded network, the embedded one is only the first fallback
+                if (HIDDEN_BIAS != nullptr) return false;
             }
+        }
 
-            fclose(f);
-        } else {
-            int memoryIndex = 0;
-            std::memcpy(INPUT_WEIGHTS, &gEvalData[memoryIndex],
-                        BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE * sizeof(int16_t));
-            memoryIndex += BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE * sizeof(int16_t);
-            std::memcpy(HIDDEN_BIAS, &gEvalData[memoryIndex], N_HIDDEN_SIZE * sizeof(int16_t));
-            memoryIndex += N_HIDDEN_SIZE * sizeof(int16_t);
+        if (block.ptr == nullptr) {
+            [[maybe_unused]] const bool valid = parse(gEvalData, gEvalSize, weights, error);
+            assert(valid);
+        }
+
+        INPUT_WEIGHTS = weights.input_weights;
+        INPUT_WEIGHTS_INT8 = weights.input_weights_int8;
+        HIDDEN_BIAS = weights.hidden_bias;
+        HIDDEN_WEIGHTS = weights.hidden_weights;
+        OUTPUT_BIAS = weights.output_bias;
+        hidden_size = weights.hidden_size;
+        input_shift = weights.input_shift;
+
+        simd::init(hidden_size);
+
+        // the previous network is not used by any accumulator once the version changes
+        memory::free(network_file);
+        network_file = block;
+
+        network_version++;
+
+        std::cout << "Loaded NNUE network with " << hidden_size << " hidden neurons and "
+                  << (quantized() ? "int8" : "int16") << " input weights, using "
+                  << simd::active.name << " kernels" << std::endl;
+
+        return filename[0] == '\0' || block.ptr != nullptr;
+    }
+
+    bool save(const std::string &filename) { return write(filename, active()); }
+
+    bool convert(const std::string &input, const std::string &output, int hidden) {
+        if (!simd::supportedHiddenSize(hidden)) {
+            std::cout << "info string hidden size " << hidden << " is not supported" << std::endl;
+            return false;
+        }
+
+        memory::Block block = memory::mapFile(input);
+
+        NetworkHeader header;
+        header.hidden = hidden;
+
+        if (block.ptr == nullptr || block.size != header.weightsSize()) {
+            std::cout << "info string " << input << " is not a network with " << hidden
+                      << " hidden neurons and without a header" << std::endl;
+            memory::free(block);
+            return false;
+        }
+
+        const bool written =
+                write(output, weightsAt(static_cast<const unsigned char *>(block.ptr), header));
+
+        memory::free(block);
+
+        return written;
+    }
+
+    bool quantize(const std::string &input, const std::string &output) {
+        memory::Block block = memory::mapFile(input);
+
+        Weights weights;
+        std::string error;
+
+        if (block.ptr == nullptr ||
+            !parse(static_cast<const unsigned char *>(block.ptr), block.size, weights, error) ||
+            weights.input_weights_int8 != nullptr) {
+            std::cout << "info string " << input << " is not a network with int16 input weights "
+                      << error << std::endl;
+            memory::free(block);
+            return false;
+        }
 
-            std::memcpy(HIDDEN_WEIGHTS, &gEvalData[memoryIndex], 2 * N_HIDDEN_SIZE * sizeof(int16_t));
-            memoryIndex += 2 * N_HIDDEN_SIZE * sizeof(int16_t);
-            std::memcpy(OUTPUT_BIAS, &gEvalData[memoryIndex], 1 * sizeof(int32_t));
-            memoryIndex += OUTPUTS * sizeof(int32_t);
+        const int hidden = weights.hidden_size;
+        const std::size_t inputs = std::size_t(BUCKETS) * FEATURE_SIZE * hidden;
+
+        // the smallest shift which rounds the largest weight into the int8 range
+        int largest = 0;
+        for (std::size_t i = 0; i < inputs; i++)
+            largest = std::max(largest, std::abs(int(weights.input_weights[i])));
+
+        int shift = 0;
+        while (((largest + (1 << shift >> 1)) >> shift) > 127) shift++;
+
+        const auto scale = [shift](int16_t value) {
+            return (value + (1 << shift >> 1)) >> shift;
+        };
+
+        NetworkHeader header;
+        header.hidden = hidden;
+        header.input_bits = 8;
+        header.input_shift = shift;
+
+        // laid out as in the file, weightsAt finds the parts again once they are filled in
+        std::vector<unsigned char> data(header.weightsSize());
+
+        auto *input_weights = reinterpret_cast<int8_t *>(data.data());
+        auto *hidden_bias = reinterpret_cast<int16_t *>(data.data() + inputs);
+        auto *hidden_weights = hidden_bias + hidden;
+        auto *output_bias = reinterpret_cast<int32_t *>(hidden_weights + 2 * hidden);
+
+        int64_t error_sum = 0;
+
+        for (std::size_t i = 0; i < inputs; i++) {
+            const int value = std::clamp(scale(weights.input_weights[i]), -128, 127);
+            input_weights[i] = static_cast<int8_t>(value);
+            error_sum += std::abs(input_weights[i] * (1 << shift) - weights.input_weights[i]);
+        }
+
+        for (int i = 0; i < hidden; i++) {
+            hidden_bias[i] = static_cast<int16_t>(scale(weights.hidden_bias[i]));
         }
 
-        std::cout << "Loaded NNUE network" << std::endl;
+        std::copy(weights.hidden_weights, weights.hidden_weights + 2 * hidden, hidden_weights);
+        std::copy(weights.output_bias, weights.output_bias + OUTPUTS, output_bias);
+
+        memory::free(block);
+
+        std::cout << "info string input weights scaled down by 2^" << shift
+                  << ", mean rounding error " << double(error_sum) / inputs << std::endl;
+
+        return write(output, weightsAt(data.data(), header));
     }
 }  // namespace nnue
\ No newline at end of file
@@ -4,18 +4,30 @@
 #include <cstdint>  // int32_t
 #include <cstdio>   // file reading
 #include <cstring>  // memcpy
+#include <string>
 
 #include "types.h"
 
-#define BUCKETS 4
-#define FEATURE_SIZE 64 * 12
-#define N_HIDDEN_SIZE 512
-#define OUTPUTS 1
+constexpr int BUCKETS = 4;
+constexpr int FEATURE_SIZE = 64 * 12;
+constexpr int OUTPUTS = 1;
 
-extern int16_t INPUT_WEIGHTS[BUCKETS * FEATURE_SIZE * N_HIDDEN_SIZE];
-extern int16_t HIDDEN_BIAS[N_HIDDEN_SIZE];
-extern int16_t HIDDEN_WEIGHTS[N_HIDDEN_SIZE * 2];
-extern int32_t OUTPUT_BIAS[OUTPUTS];
+// hidden sizes with kernels of their own, a network of any of them can be loaded at runtime
+constexpr std::array<int, 2> HIDDEN_SIZES = {256, 512};
+
+// the accumulators have room for the largest network, smaller ones use a prefix of it
+constexpr int MAX_HIDDEN_SIZE = 512;
+
+// hidden size of a network file without a header, like the embedded one
+constexpr int DEFAULT_HIDDEN_SIZE = 512;
+
+// The weights are used in place from the mapped network file or the embedded network,
+// processes which load the same file share one copy in the page cache
+extern const int16_t *INPUT_WEIGHTS;   // BUCKETS * FEATURE_SIZE * hidden size
+extern const int8_t *INPUT_WEIGHTS_INT8;  // used instead of INPUT_WEIGHTS by a quantized network
+extern const int16_t *HIDDEN_BIAS;     // hidden size
+extern const int16_t *HIDDEN_WEIGHTS;  // hidden size * 2
+extern const int32_t *OUTPUT_BIAS;     // OUTPUTS
 
 namespace nnue {
 
@@ -33,12 +45,72 @@ constexpr int KING_BUCKET[64] {
 
 // clang-format on
 
-using accumulator = std::array<std::array<int16_t, N_HIDDEN_SIZE>, 2>;
+// features of one perspective
+using perspective_accumulator = std::array<int16_t, MAX_HIDDEN_SIZE>;
+
+using accumulator = std::array<perspective_accumulator, 2>;
+
+// Header in front of the weights of a network file. Files without it are read as the
+// default architecture. The weights follow in the order of the globals above.
+struct NetworkHeader {
+    static constexpr uint32_t MAGIC = 0x4e4e4253;  // "SBNN"
+    static constexpr uint32_t VERSION = 2;
+
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+
+    uint32_t buckets = BUCKETS;
+    uint32_t features = FEATURE_SIZE;
+    uint32_t hidden = DEFAULT_HIDDEN_SIZE;
+    uint32_t outputs = OUTPUTS;
+
+    // networkHash() of the weights
+    uint64_t hash = 0;
+
+    // Added in version 2, version 1 files have int16 input weights.
+    // A quantized network stores the input weights with 8 bits, its hidden bias and therefore
+    // its accumulators are scaled down by 2^input_shift.
+    uint32_t input_bits = 16;
+    uint32_t input_shift = 0;
+
+    // the weights start at a cache line boundary
+    std::array<uint8_t, 24> reserved = {};
+
+    /// @brief bytes of the weights which follow the header
+    [[nodiscard]] std::size_t weightsSize() const {
+        return std::size_t(buckets) * features * hidden * (input_bits / 8) +
+               (hidden + 2 * hidden) * sizeof(int16_t) + outputs * sizeof(int32_t);
+    }
+};
+
+static_assert(sizeof(NetworkHeader) == 64, "the weights have to start at a cache line");
 
 [[nodiscard]] int16_t relu(int16_t x);
 
-// load the weights and bias
-void init(const char *filename);
+// map the network file, the embedded network is used if the name is empty or the file
+// can not be opened. An incompatible or corrupt network is rejected and the loaded one is kept.
+// The weights are used in place, the file must not be modified or truncated while it is
+// loaded, a truncated file raises SIGBUS.
+bool init(const char *filename);
+
+// write the loaded network with a header
+bool save(const std::string &filename);
+
+// wrap a network file without a header and of the given hidden size into one with a header
+bool convert(const std::string &input, const std::string &output, int hidden_size);
+
+// write a network with int8 input weights, the int16 weights of the input network are scaled
+// down by the smallest power of two which makes them fit and rounded
+bool quantize(const std::string &input, const std::string &output);
+
+// the loaded network has int8 input weights
+[[nodiscard]] bool quantized();
+
+// hidden size of the loaded network
+[[nodiscard]] int hiddenSize();
+
+// hash of the loaded weights, identifies the network in files which depend on it
+[[nodiscard]] uint64_t networkHash();
 
 // activate a certain input and update the accumulator
 void activate(nnue::accumulator &accumulator, Square sq, Piece p, Square ksq_white,
@@ -52,6 +124,33 @@ void deactivate(nnue::accumulator &accumulator, Square sq, Piece p, Square ksq_w
 void move(nnue::accumulator &accumulator, Square from_sq, Square to_sq, Piece p, Square ksq_white,
           Square ksq_black);
 
+// activate a certain input for a single perspective, ksq is the king of that perspective
+void activate(nnue::perspective_accumulator &accumulator, Color perspective, Square sq, Piece p,
+              Square ksq);
+
+// deactivate a certain input for a single perspective
+void deactivate(nnue::perspective_accumulator &accumulator, Color perspective, Square sq, Piece p,
+                Square ksq);
+
+// move a piece for a single perspective
+void move(nnue::perspective_accumulator &accumulator, Color perspective, Square from_sq,
+          Square to_sq, Piece p, Square ksq);
+
+// a piece on a square, one input of the network
+struct Feature {
+    Piece piece;
+    Square sq;
+};
+
+// out = in with the added inputs activated and the removed ones deactivated, for a single
+// perspective. Up to one added and two removed or two of each are fused into one pass.
+void update(const nnue::perspective_accumulator &in, nnue::perspective_accumulator &out,
+            Color perspective, Square ksq, const Feature *added, int added_count,
+            const Feature *removed, int removed_count);
+
+// version of the loaded weights, changes with every init
+[[nodiscard]] uint32_t networkVersion();
+
 // return the nnue evaluation
 [[nodiscard]] int32_t output(const nnue::accumulator &accumulator, Color side);
 }  // namespace nnue
\ No newline at end of file
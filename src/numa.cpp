@@ -0,0 +1,116 @@
+#include "numa.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace numa {
+
+namespace {
+
+bool binding_enabled = true;
+
+/// @brief parse a cpu list like "0-15,32-47"
+std::vector<int> parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+
+    std::stringstream ss(list);
+    std::string range;
+
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) continue;
+
+        const auto dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+        for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    }
+
+    return cpus;
+}
+
+std::vector<std::vector<int>> detect() {
+    std::vector<std::vector<int>> result;
+
+#if defined(__linux__)
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string line;
+
+    if (online && std::getline(online, line)) {
+        for (int node : parseCpuList(line)) {
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) +
+                                  "/cpulist");
+            std::string cpus;
+
+            // memory only nodes have no cpus to run on
+            if (cpulist && std::getline(cpulist, cpus) && !parseCpuList(cpus).empty()) {
+                result.push_back(parseCpuList(cpus));
+            }
+        }
+    }
+#endif
+
+    if (result.empty()) result.emplace_back();
+
+    return result;
+}
+
+#if defined(__linux__)
+cpu_set_t initialAffinity() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    sched_getaffinity(0, sizeof(set), &set);
+    return set;
+}
+
+const cpu_set_t initial_affinity = initialAffinity();
+#endif
+
+}  // namespace
+
+const std::vector<std::vector<int>> &nodes() {
+    static const std::vector<std::vector<int>> detected = detect();
+    return detected;
+}
+
+void setEnabled(bool enabled) { binding_enabled = enabled; }
+
+bool enabled() { return binding_enabled; }
+
+bool active() { return binding_enabled && nodes().size() > 1; }
+
+int nodeOf(int index) { return index % static_cast<int>(nodes().size()); }
+
+void bindThread(int index) {
+    if (!active()) return;
+
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    // stay within the cpus the process was started on, e.g. with taskset
+    for (int cpu : nodes()[nodeOf(index)]) {
+        if (CPU_ISSET(cpu, &initial_affinity)) CPU_SET(cpu, &set);
+    }
+
+    // none of them belongs to the node, keep the initial affinity
+    if (CPU_COUNT(&set) == 0) set = initial_affinity;
+
+    sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+void unbindThread() {
+    if (!active()) return;
+
+#if defined(__linux__)
+    sched_setaffinity(0, sizeof(initial_affinity), &initial_affinity);
+#endif
+}
+
+}  // namespace numa
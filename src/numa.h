@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+namespace numa {
+
+/// @brief cpus of every NUMA node, read from /sys on Linux. Other systems report a single node.
+/// @return
+[[nodiscard]] const std::vector<std::vector<int>> &nodes();
+
+/// @brief enable or disable thread binding, enabled by default
+/// @param enabled
+void setEnabled(bool enabled);
+
+[[nodiscard]] bool enabled();
+
+/// @brief binding is enabled and the machine has more than one node
+/// @return
+[[nodiscard]] bool active();
+
+/// @brief node which is assigned to the index-th thread, round robin over all nodes
+/// @param index
+/// @return
+[[nodiscard]] int nodeOf(int index);
+
+/// @brief bind the calling thread to the cpus of the node which is assigned to index which the
+/// process was started on. Keeps the initial affinity if there are none, does nothing unless
+/// active()
+/// @param index
+void bindThread(int index);
+
+/// @brief restore the affinity the process was started with
+void unbindThread();
+
+}  // namespace numa
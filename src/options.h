@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "types.h"
 
@@ -18,6 +20,9 @@ namespace uci {
         std::string default_value;
         std::string min;
         std::string max;
+
+        // values a combo option can take
+        std::vector<std::string> vars = {};
     };
 
     class Options {
@@ -29,6 +34,9 @@ namespace uci {
                 if (!option.min.empty()) {
                     std::cout << " min " << option.min << " max " << option.max;
                 }
+                for (const auto &var: option.vars) {
+                    std::cout << " var " << var;
+                }
                 std::cout << std::endl;
             }
         }
@@ -94,6 +102,14 @@ namespace uci {
                 }
             } else if (options_[name].type == "string") {
                 options_[name].value = value;
+            } else if (options_[name].type == "combo") {
+                const auto &vars = options_[name].vars;
+                if (std::find(vars.begin(), vars.end(), value) != vars.end()) {
+                    options_[name].value = value;
+                } else {
+                    std::cout << ("Invalid value for option " + name + ": " + value);
+                    std::exit(1);
+                }
             }
         }
 
@@ -25,6 +25,12 @@ void init_reductions() {
     }
 }
 
+// Lazy SMP depth skipping, helper i skips the depths where
+// (depth + ply + SKIP_PHASE[i]) / SKIP_SIZE[i] is odd
+constexpr int SKIP_COUNT = 20;
+constexpr int SKIP_SIZE[SKIP_COUNT] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+constexpr int SKIP_PHASE[SKIP_COUNT] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
 [[nodiscard]] Score mateIn(int ply) { return (VALUE_MATE - ply); }
 
 [[nodiscard]] Score matedIn(int ply) { return (ply - VALUE_MATE); }
@@ -76,24 +82,36 @@ Score Search::qsearch(Score alpha, Score beta, Stack *ss) {
     Move ttmove = NO_MOVE;
     bool tt_hit = false;
 
-    const TEntry *tte = TTable.probe(tt_hit, ttmove, board.hash());
+    const TEntry *tte = TTable.probe(tt_hit, ttmove, board.hash(), ttStats());
     const Score tt_score = tt_hit ? scoreFromTT(tte->score, ss->ply) : Score(VALUE_NONE);
 
     // clang-format off
     if (tt_hit
         && !pv_node
         && tt_score != VALUE_NONE
-        && tte->flag != NONEBOUND) {
+        && tte->flag() != NONEBOUND) {
         // clang-format on
-        if (tte->flag == EXACTBOUND)
-            return tt_score;
-        else if (tte->flag == LOWERBOUND && tt_score >= beta)
-            return tt_score;
-        else if (tte->flag == UPPERBOUND && tt_score <= alpha)
+        if (tte->flag() == EXACTBOUND || (tte->flag() == LOWERBOUND && tt_score >= beta) ||
+            (tte->flag() == UPPERBOUND && tt_score <= alpha)) {
+            if (collect_tt_stats) tt_stats.cutoffs++;
             return tt_score;
+        }
     }
 
-    Score best_value = eval::evaluate(board);
+    // reuse the raw static evaluation cached in the TT, the halfmove scaling
+    // depends on the current position. Other threads may overwrite the entry,
+    // so it is read once.
+    const Score tt_eval = tt_hit ? tte->eval : Score(VALUE_NONE);
+    Score static_eval = VALUE_NONE;
+
+    if (tt_eval != VALUE_NONE) {
+        static_eval = tt_eval;
+        evals_saved++;
+    } else {
+        static_eval = eval::rawEvaluate(board, eval_cache);
+    }
+
+    Score best_value = eval::scale(static_eval, board.halfmoves());
 
     if (best_value >= beta) return best_value;
     if (best_value > alpha) alpha = best_value;
@@ -156,7 +174,8 @@ Score Search::qsearch(Score alpha, Score beta, Stack *ss) {
     const Flag bound = best_value >= beta ? LOWERBOUND : UPPERBOUND;
 
     if (!Threads.stop.load(std::memory_order_relaxed))
-        TTable.store(0, scoreToTT(best_value, ss->ply), bound, board.hash(), bestmove);
+        TTable.store(0, scoreToTT(best_value, ss->ply), bound, board.hash(), bestmove,
+                     static_eval, ttStats());
 
     assert(best_value > -VALUE_INFINITE && best_value < VALUE_INFINITE);
     return best_value;
@@ -222,9 +241,12 @@ Score Search::absearch(int depth, Score alpha, Score beta, Stack *ss) {
     Move ttmove = NO_MOVE;
     bool tt_hit = false;
 
-    const TEntry *tte = TTable.probe(tt_hit, ttmove, board.hash());
+    const TEntry *tte = TTable.probe(tt_hit, ttmove, board.hash(), ttStats());
     const Score tt_score = tt_hit ? scoreFromTT(tte->score, ss->ply) : Score(VALUE_NONE);
 
+    // other threads may overwrite the entry, the cached eval is read once
+    const Score tt_eval = tt_hit ? tte->eval : Score(VALUE_NONE);
+
     const Move excluded_move = ss->excluded_move;
 
     /********************
@@ -240,13 +262,17 @@ Score Search::absearch(int depth, Score alpha, Score beta, Stack *ss) {
         && tte->depth >= depth
         && (ss - 1)->currentmove != NULL_MOVE) {
         // clang-format on
-        if (tte->flag == EXACTBOUND)
+        if (tte->flag() == EXACTBOUND) {
+            if (collect_tt_stats) tt_stats.cutoffs++;
             return tt_score;
-        else if (tte->flag == LOWERBOUND)
+        } else if (tte->flag() == LOWERBOUND)
             alpha = std::max(alpha, tt_score);
-        else if (tte->flag == UPPERBOUND)
+        else if (tte->flag() == UPPERBOUND)
             beta = std::min(beta, tt_score);
-        if (alpha >= beta) return tt_score;
+        if (alpha >= beta) {
+            if (collect_tt_stats) tt_stats.cutoffs++;
+            return tt_score;
+        }
     }
 
     Score max_value = VALUE_INFINITE;
@@ -280,7 +306,8 @@ Score Search::absearch(int depth, Score alpha, Score beta, Stack *ss) {
 
         if (flag == EXACTBOUND || (flag == LOWERBOUND && tb_res >= beta) ||
             (flag == UPPERBOUND && tb_res <= alpha)) {
-            TTable.store(depth + 6, scoreToTT(tb_res, ss->ply), flag, board.hash(), NO_MOVE);
+            TTable.store(depth + 6, scoreToTT(tb_res, ss->ply), flag, board.hash(), NO_MOVE,
+                         VALUE_NONE, ttStats());
             return tb_res;
         }
 
@@ -296,6 +323,9 @@ Score Search::absearch(int depth, Score alpha, Score beta, Stack *ss) {
 
     bool improving = false;
 
+    // raw static evaluation which is cached in the TT, unknown when in check
+    Score static_eval = VALUE_NONE;
+
     if (in_check) {
         ss->eval = VALUE_NONE;
         goto moves;
@@ -303,7 +333,13 @@ Score Search::absearch(int depth, Score alpha, Score beta, Stack *ss) {
 
     // Use the tt_score as a better evaluation of the position, other engines
     // typically have eval and staticEval. In Smallbrain its just eval.
-    ss->eval = tt_hit ? tt_score : eval::evaluate(board);
+    if (tt_hit) {
+        static_eval = tt_eval;
+        ss->eval = tt_score;
+    } else {
+        static_eval = eval::rawEvaluate(board, eval_cache);
+        ss->eval = eval::scale(static_eval, board.halfmoves());
+    }
 
     // improving boolean
     improving = (ss - 2)->eval != VALUE_NONE && ss->eval > (ss - 2)->eval;
@@ -423,7 +459,7 @@ moves:
             && ttmove == move
             && !excluded_move
             && std::abs(tt_score) < 10000
-            && tte->flag & LOWERBOUND
+            && tte->flag() & LOWERBOUND
             && tte->depth >= depth - 3) {
             // clang-format on
             const Score singular_beta = tt_score - 3 * depth;
@@ -575,7 +611,8 @@ moves:
         best >= beta ? LOWERBOUND : (pv_node && bestmove != NO_MOVE ? EXACTBOUND : UPPERBOUND);
 
     if (!excluded_move && !Threads.stop.load(std::memory_order_relaxed))
-        TTable.store(depth, scoreToTT(best, ss->ply), b, board.hash(), bestmove);
+        TTable.store(depth, scoreToTT(best, ss->ply), b, board.hash(), bestmove, static_eval,
+                     ttStats());
 
     assert(best > -VALUE_INFINITE && best < VALUE_INFINITE);
     return best;
@@ -658,6 +695,10 @@ SearchResult Search::iterativeDeepening() {
     pv_length_.reset();
     node_effort.reset();
 
+    completed_depth = 0;
+    completed_result = SearchResult();
+    completed_pv.clear();
+
     auto lastPv = getPV();
 
     /********************
@@ -668,6 +709,12 @@ SearchResult Search::iterativeDeepening() {
 
     int depth = 1;
     for (; depth <= limit.depth; depth++) {
+        // helpers skip some depths, so that not every thread searches the same tree
+        if (id != 0 && Threads.depthSkipping()) {
+            const int i = (id - 1) % SKIP_COUNT;
+            if (((depth + board.ply() + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2) continue;
+        }
+
         seldepth_ = 0;
 
         const auto previousResult = search_result.score;
@@ -675,9 +722,6 @@ SearchResult Search::iterativeDeepening() {
 
         if (limitReached()) break;
 
-        // only mainthread manages time control
-        if (id != 0) continue;
-
         if (search_result.bestmove != pv_table_[0][0]) bestmove_changes++;
 
         search_result.bestmove = pv_table_[0][0];
@@ -685,6 +729,13 @@ SearchResult Search::iterativeDeepening() {
 
         lastPv = getPV();
 
+        completed_depth = depth;
+        completed_result = search_result;
+        completed_pv = lastPv;
+
+        // only mainthread manages time control
+        if (id != 0) continue;
+
         eval_average += search_result.score;
 
         // limit type time
@@ -716,8 +767,7 @@ SearchResult Search::iterativeDeepening() {
      * Dont stop analysis in infinite mode when max depth is reached
      * wait for uci stop or quit
      *******************/
-    while (limit.infinite && !Threads.stop.load(std::memory_order_relaxed)) {
-    }
+    if (limit.infinite) Threads.waitForStop();
 
     /********************
      * In case the depth was 1 make sure we have at least a bestmove.
@@ -729,14 +779,26 @@ SearchResult Search::iterativeDeepening() {
      * Allowprint is disabled in data generation
      *******************/
     if (id == 0 && !silent) {
+        // the result of another thread may be more trustworthy, it is only taken
+        // once that thread completed an iteration
+        const Search &best = Threads.bestThread(*this);
+
+        if (&best != this) {
+            search_result = best.completed_result;
+            depth = best.completed_depth;
+            lastPv = best.completed_pv;
+        }
+
         uci::output(
             search_result.score, board.ply(), depth, seldepth_, Threads.getNodes(),
             Threads.getTbHits(), getTime(),
             lastPv.empty() ? uci::moveToUci(search_result.bestmove, board.chess960) : lastPv,
             TTable.hashfull());
+        uci::outputTTStats(Threads.getTTStats());
+        uci::outputEvalCacheStats(Threads.getEvalCacheStats());
         std::cout << "bestmove " << uci::moveToUci(search_result.bestmove, board.chess960)
                   << std::endl;
-        Threads.stop = true;
+        Threads.stopSearch();
     }
 
     printMean();
@@ -747,6 +809,9 @@ SearchResult Search::iterativeDeepening() {
 void Search::reset() {
     nodes = 0;
     tbhits = 0;
+    evals_saved = 0;
+    tt_stats = TTStats();
+    eval_cache.stats = EvalCache::Stats();
 
     node_effort.reset();
 
@@ -765,6 +830,8 @@ void Search::startThinking() {
     t0_ = TimePoint::now();
     check_time_ = 0;
 
+    eval_cache.validate();
+
     /********************
      * Play dtz move when time is limited
      *******************/
@@ -774,7 +841,7 @@ void Search::startThinking() {
             uci::output(dtz.first, 1, 1, 1, 1, 1, 0,
                         " " + uci::moveToUci(dtz.second, board.chess960), 0);
             std::cout << "bestmove " << uci::moveToUci(dtz.second, board.chess960) << std::endl;
-            Threads.stop = true;
+            Threads.stopSearch();
             return;
         }
     }
@@ -797,7 +864,7 @@ bool Search::limitReached() {
         auto ms = getTime();
 
         if (ms >= limit.time.maximum) {
-            Threads.stop = true;
+            Threads.stopSearch();
 
             return true;
         }
@@ -5,6 +5,7 @@
 #include "board.h"
 #include "movegen.h"
 #include "timemanager.h"
+#include "types/eval_cache.h"
 #include "types/table.h"
 
 struct Stack {
@@ -57,6 +58,21 @@ class Search {
     U64 nodes = 0;
     U64 tbhits = 0;
 
+    // static evaluations taken from the TT instead of computing them
+    U64 evals_saved = 0;
+
+    // TT usage counters, only collected if collect_tt_stats is set
+    TTStats tt_stats;
+    bool collect_tt_stats = false;
+
+    // network outputs of positions this thread evaluated before
+    EvalCache eval_cache;
+
+    // last completed iteration, the mainthread picks the thread whose result it plays from them
+    int completed_depth = 0;
+    SearchResult completed_result = {};
+    std::string completed_pv;
+
     // thread id, Mainthread = 0
     int id = 0;
 
@@ -81,6 +97,8 @@ class Search {
     [[nodiscard]] bool limitReached();
 
     [[nodiscard]] std::string getPV() const;
+
+    [[nodiscard]] TTStats *ttStats() { return collect_tt_stats ? &tt_stats : nullptr; }
     [[nodiscard]] int64_t getTime() const;
 
     // pv collection
@@ -0,0 +1,454 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+namespace {
+
+// Every kernel is a template on the hidden size, so the loops of each supported network have
+// constant trip counts and are unrolled for it. The update kernels are also templates on the
+// type of the input weights, int8 weights are sign extended to int16 while they are loaded.
+
+template <int N, typename W>
+void addScalar(int16_t *acc, const W *weights) {
+    for (int i = 0; i < N; i++) acc[i] += weights[i];
+}
+
+template <int N, typename W>
+void subScalar(int16_t *acc, const W *weights) {
+    for (int i = 0; i < N; i++) acc[i] -= weights[i];
+}
+
+template <int N, typename W>
+void addSubScalar(int16_t *acc, const W *add, const W *sub) {
+    for (int i = 0; i < N; i++) acc[i] += add[i] - sub[i];
+}
+
+template <int N, typename W>
+void add1Sub1Scalar(int16_t *out, const int16_t *in, const W *add, const W *sub) {
+    for (int i = 0; i < N; i++) out[i] = in[i] + add[i] - sub[i];
+}
+
+template <int N, typename W>
+void add1Sub2Scalar(int16_t *out, const int16_t *in, const W *add, const W *sub1, const W *sub2) {
+    for (int i = 0; i < N; i++) out[i] = in[i] + add[i] - sub1[i] - sub2[i];
+}
+
+template <int N, typename W>
+void add2Sub2Scalar(int16_t *out, const int16_t *in, const W *add1, const W *add2, const W *sub1,
+                    const W *sub2) {
+    for (int i = 0; i < N; i++) out[i] = in[i] + add1[i] + add2[i] - sub1[i] - sub2[i];
+}
+
+template <int N>
+int32_t dotReluScalar(const int16_t *acc, const int16_t *weights) {
+    int32_t sum = 0;
+
+    for (int i = 0; i < N; i++) sum += std::max(int16_t(0), acc[i]) * weights[i];
+
+    return sum;
+}
+
+#ifdef SIMD_X86
+
+// Each kernel is compiled for its instruction set with a target attribute, the rest of the
+// binary keeps the flags of the build. Loads are unaligned, on aligned data they cost the same.
+// madd multiplies pairs of int16 into int32, so no product is truncated.
+
+// SSE2 is part of every x86-64 cpu
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+
+TARGET_SSE2 inline __m128i loadSSE2(const int16_t *weights) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights));
+}
+
+// SSE2 has no sign extension, the bytes are doubled and shifted back arithmetically
+TARGET_SSE2 inline __m128i loadSSE2(const int8_t *weights) {
+    const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights));
+    return _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+}
+
+template <int N, typename W>
+TARGET_SSE2 void addSSE2(int16_t *acc, const W *weights) {
+    for (int i = 0; i < N; i += 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+        const __m128i w = loadSSE2(weights + i);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), _mm_add_epi16(a, w));
+    }
+}
+
+template <int N, typename W>
+TARGET_SSE2 void subSSE2(int16_t *acc, const W *weights) {
+    for (int i = 0; i < N; i += 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+        const __m128i w = loadSSE2(weights + i);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), _mm_sub_epi16(a, w));
+    }
+}
+
+template <int N, typename W>
+TARGET_SSE2 void addSubSSE2(int16_t *acc, const W *add, const W *sub) {
+    for (int i = 0; i < N; i += 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+        const __m128i p = loadSSE2(add + i);
+        const __m128i m = loadSSE2(sub + i);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i),
+                         _mm_add_epi16(a, _mm_sub_epi16(p, m)));
+    }
+}
+
+template <int N, typename W>
+TARGET_SSE2 void add1Sub1SSE2(int16_t *out, const int16_t *in, const W *add, const W *sub) {
+    for (int i = 0; i < N; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        v = _mm_add_epi16(v, loadSSE2(add + i));
+        v = _mm_sub_epi16(v, loadSSE2(sub + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), v);
+    }
+}
+
+template <int N, typename W>
+TARGET_SSE2 void add1Sub2SSE2(int16_t *out, const int16_t *in, const W *add, const W *sub1,
+                              const W *sub2) {
+    for (int i = 0; i < N; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        v = _mm_add_epi16(v, loadSSE2(add + i));
+        v = _mm_sub_epi16(v, loadSSE2(sub1 + i));
+        v = _mm_sub_epi16(v, loadSSE2(sub2 + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), v);
+    }
+}
+
+template <int N, typename W>
+TARGET_SSE2 void add2Sub2SSE2(int16_t *out, const int16_t *in, const W *add1, const W *add2,
+                              const W *sub1, const W *sub2) {
+    for (int i = 0; i < N; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        v = _mm_add_epi16(v, loadSSE2(add1 + i));
+        v = _mm_add_epi16(v, loadSSE2(add2 + i));
+        v = _mm_sub_epi16(v, loadSSE2(sub1 + i));
+        v = _mm_sub_epi16(v, loadSSE2(sub2 + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), v);
+    }
+}
+
+template <int N>
+TARGET_SSE2 int32_t dotReluSSE2(const int16_t *acc, const int16_t *weights) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+
+    for (int i = 0; i < N; i += 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+        const __m128i w = loadSSE2(weights + i);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_max_epi16(a, zero), w));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(sum);
+}
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2 inline __m256i loadAVX2(const int16_t *weights) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights));
+}
+
+TARGET_AVX2 inline __m256i loadAVX2(const int8_t *weights) {
+    return _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(weights)));
+}
+
+template <int N, typename W>
+TARGET_AVX2 void addAVX2(int16_t *acc, const W *weights) {
+    for (int i = 0; i < N; i += 16) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+        const __m256i w = loadAVX2(weights + i);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_add_epi16(a, w));
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX2 void subAVX2(int16_t *acc, const W *weights) {
+    for (int i = 0; i < N; i += 16) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+        const __m256i w = loadAVX2(weights + i);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_sub_epi16(a, w));
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX2 void addSubAVX2(int16_t *acc, const W *add, const W *sub) {
+    for (int i = 0; i < N; i += 16) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+        const __m256i p = loadAVX2(add + i);
+        const __m256i m = loadAVX2(sub + i);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i),
+                            _mm256_add_epi16(a, _mm256_sub_epi16(p, m)));
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX2 void add1Sub1AVX2(int16_t *out, const int16_t *in, const W *add, const W *sub) {
+    for (int i = 0; i < N; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        v = _mm256_add_epi16(v, loadAVX2(add + i));
+        v = _mm256_sub_epi16(v, loadAVX2(sub + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), v);
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX2 void add1Sub2AVX2(int16_t *out, const int16_t *in, const W *add, const W *sub1,
+                              const W *sub2) {
+    for (int i = 0; i < N; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        v = _mm256_add_epi16(v, loadAVX2(add + i));
+        v = _mm256_sub_epi16(v, loadAVX2(sub1 + i));
+        v = _mm256_sub_epi16(v, loadAVX2(sub2 + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), v);
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX2 void add2Sub2AVX2(int16_t *out, const int16_t *in, const W *add1, const W *add2,
+                              const W *sub1, const W *sub2) {
+    for (int i = 0; i < N; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        v = _mm256_add_epi16(v, loadAVX2(add1 + i));
+        v = _mm256_add_epi16(v, loadAVX2(add2 + i));
+        v = _mm256_sub_epi16(v, loadAVX2(sub1 + i));
+        v = _mm256_sub_epi16(v, loadAVX2(sub2 + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), v);
+    }
+}
+
+template <int N>
+TARGET_AVX2 int32_t dotReluAVX2(const int16_t *acc, const int16_t *weights) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int i = 0; i < N; i += 16) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+        const __m256i w = loadAVX2(weights + i);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_max_epi16(a, zero), w));
+    }
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(half);
+}
+
+// 16 bit arithmetic on 512 bit registers needs AVX-512BW on top of AVX-512F
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+
+TARGET_AVX512 inline __m512i loadAVX512(const int16_t *weights) {
+    return _mm512_loadu_si512(weights);
+}
+
+TARGET_AVX512 inline __m512i loadAVX512(const int8_t *weights) {
+    return _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights)));
+}
+
+template <int N, typename W>
+TARGET_AVX512 void addAVX512(int16_t *acc, const W *weights) {
+    for (int i = 0; i < N; i += 32) {
+        const __m512i a = _mm512_loadu_si512(acc + i);
+        const __m512i w = loadAVX512(weights + i);
+        _mm512_storeu_si512(acc + i, _mm512_add_epi16(a, w));
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX512 void subAVX512(int16_t *acc, const W *weights) {
+    for (int i = 0; i < N; i += 32) {
+        const __m512i a = _mm512_loadu_si512(acc + i);
+        const __m512i w = loadAVX512(weights + i);
+        _mm512_storeu_si512(acc + i, _mm512_sub_epi16(a, w));
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX512 void addSubAVX512(int16_t *acc, const W *add, const W *sub) {
+    for (int i = 0; i < N; i += 32) {
+        const __m512i a = _mm512_loadu_si512(acc + i);
+        const __m512i p = loadAVX512(add + i);
+        const __m512i m = loadAVX512(sub + i);
+        _mm512_storeu_si512(acc + i, _mm512_add_epi16(a, _mm512_sub_epi16(p, m)));
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX512 void add1Sub1AVX512(int16_t *out, const int16_t *in, const W *add, const W *sub) {
+    for (int i = 0; i < N; i += 32) {
+        __m512i v = _mm512_loadu_si512(in + i);
+        v = _mm512_add_epi16(v, loadAVX512(add + i));
+        v = _mm512_sub_epi16(v, loadAVX512(sub + i));
+        _mm512_storeu_si512(out + i, v);
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX512 void add1Sub2AVX512(int16_t *out, const int16_t *in, const W *add, const W *sub1,
+                                  const W *sub2) {
+    for (int i = 0; i < N; i += 32) {
+        __m512i v = _mm512_loadu_si512(in + i);
+        v = _mm512_add_epi16(v, loadAVX512(add + i));
+        v = _mm512_sub_epi16(v, loadAVX512(sub1 + i));
+        v = _mm512_sub_epi16(v, loadAVX512(sub2 + i));
+        _mm512_storeu_si512(out + i, v);
+    }
+}
+
+template <int N, typename W>
+TARGET_AVX512 void add2Sub2AVX512(int16_t *out, const int16_t *in, const W *add1, const W *add2,
+                                  const W *sub1, const W *sub2) {
+    for (int i = 0; i < N; i += 32) {
+        __m512i v = _mm512_loadu_si512(in + i);
+        v = _mm512_add_epi16(v, loadAVX512(add1 + i));
+        v = _mm512_add_epi16(v, loadAVX512(add2 + i));
+        v = _mm512_sub_epi16(v, loadAVX512(sub1 + i));
+        v = _mm512_sub_epi16(v, loadAVX512(sub2 + i));
+        _mm512_storeu_si512(out + i, v);
+    }
+}
+
+template <int N>
+TARGET_AVX512 int32_t dotReluAVX512(const int16_t *acc, const int16_t *weights) {
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i sum = _mm512_setzero_si512();
+
+    for (int i = 0; i < N; i += 32) {
+        const __m512i a = _mm512_loadu_si512(acc + i);
+        const __m512i w = loadAVX512(weights + i);
+        sum = _mm512_add_epi32(sum, _mm512_madd_epi16(_mm512_max_epi16(a, zero), w));
+    }
+
+    // the reduce and extract intrinsics trip -Wuninitialized in the headers of gcc 12
+    alignas(64) int32_t lanes[16];
+    _mm512_store_si512(lanes, sum);
+
+    int32_t total = 0;
+    for (int32_t lane : lanes) total += lane;
+
+    return total;
+}
+
+#endif
+
+// clang-format off
+#define UPDATE_KERNELS(ISA, N, W) UpdateKernels<W>{add##ISA<N, W>, sub##ISA<N, W>, \
+    addSub##ISA<N, W>, add1Sub1##ISA<N, W>, add1Sub2##ISA<N, W>, add2Sub2##ISA<N, W>}
+
+template <int N>
+constexpr Kernels SCALAR_KERNELS{Isa::SCALAR, "scalar", N, UPDATE_KERNELS(Scalar, N, int16_t),
+    UPDATE_KERNELS(Scalar, N, int8_t), dotReluScalar<N>};
+
+#ifdef SIMD_X86
+template <int N>
+constexpr Kernels SSE2_KERNELS{Isa::SSE2, "sse2", N, UPDATE_KERNELS(SSE2, N, int16_t),
+    UPDATE_KERNELS(SSE2, N, int8_t), dotReluSSE2<N>};
+template <int N>
+constexpr Kernels AVX2_KERNELS{Isa::AVX2, "avx2", N, UPDATE_KERNELS(AVX2, N, int16_t),
+    UPDATE_KERNELS(AVX2, N, int8_t), dotReluAVX2<N>};
+template <int N>
+constexpr Kernels AVX512_KERNELS{Isa::AVX512, "avx512", N, UPDATE_KERNELS(AVX512, N, int16_t),
+    UPDATE_KERNELS(AVX512, N, int8_t), dotReluAVX512<N>};
+#endif
+
+#undef UPDATE_KERNELS
+// clang-format on
+
+template <int N>
+const Kernels &kernels(Isa isa) {
+    static_assert(N % 32 == 0, "the vector kernels process 32 elements at once");
+
+#ifdef SIMD_X86
+    switch (isa) {
+        case Isa::SSE2:
+            return SSE2_KERNELS<N>;
+        case Isa::AVX2:
+            return AVX2_KERNELS<N>;
+        case Isa::AVX512:
+            return AVX512_KERNELS<N>;
+        default:
+            break;
+    }
+#endif
+
+    return SCALAR_KERNELS<N>;
+}
+
+// instantiates the kernels of every entry of HIDDEN_SIZES, a new network size only has to be
+// added there
+template <std::size_t... I>
+const Kernels *find(Isa isa, int hidden_size, std::index_sequence<I...>) {
+    const Kernels *found = nullptr;
+    static_cast<void>(
+        ((hidden_size == HIDDEN_SIZES[I] && (found = &kernels<HIDDEN_SIZES[I]>(isa))) || ...));
+    return found;
+}
+
+}  // namespace
+
+Kernels active = SCALAR_KERNELS<MAX_HIDDEN_SIZE>;
+
+bool supported(Isa isa) {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+
+    switch (isa) {
+        case Isa::SCALAR:
+            return true;
+        case Isa::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case Isa::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case Isa::AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    }
+
+    return false;
+#else
+    return isa == Isa::SCALAR;
+#endif
+}
+
+bool supportedHiddenSize(int hidden_size) {
+    return std::find(HIDDEN_SIZES.begin(), HIDDEN_SIZES.end(), hidden_size) != HIDDEN_SIZES.end();
+}
+
+const Kernels &get(Isa isa, int hidden_size) {
+    const Kernels *found =
+        find(isa, hidden_size, std::make_index_sequence<HIDDEN_SIZES.size()>());
+
+    if (found == nullptr) {
+        std::cout << "info string no kernels for hidden size " << hidden_size << std::endl;
+        std::exit(1);
+    }
+
+    return *found;
+}
+
+void init(int hidden_size) {
+    for (Isa isa : {Isa::AVX512, Isa::AVX2, Isa::SSE2, Isa::SCALAR}) {
+        if (supported(isa)) {
+            active = get(isa, hidden_size);
+            return;
+        }
+    }
+}
+
+}  // namespace simd
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+#include "nnue.h"
+
+// Accumulator kernels for the NNUE. Every kernel is compiled for its own instruction set,
+// the best one supported by the cpu is selected at startup, so a single binary runs
+// the widest kernels on every machine.
+namespace simd {
+
+enum class Isa { SCALAR, SSE2, AVX2, AVX512 };
+
+// Kernels which add rows of the input weights to an accumulator, they exist for int16 weights
+// and for the int8 weights of a quantized network
+template <typename Weight>
+struct UpdateKernels {
+    // acc += weights
+    void (*add)(int16_t *acc, const Weight *weights);
+
+    // acc -= weights
+    void (*sub)(int16_t *acc, const Weight *weights);
+
+    // acc += add - sub
+    void (*addSub)(int16_t *acc, const Weight *add, const Weight *sub);
+
+    // Fused updates of a child accumulator from its parent, the parent is read
+    // and the child written once, however many features change.
+
+    // out = in + add - sub, a quiet move or a promotion
+    void (*add1Sub1)(int16_t *out, const int16_t *in, const Weight *add, const Weight *sub);
+
+    // out = in + add - sub1 - sub2, a capture
+    void (*add1Sub2)(int16_t *out, const int16_t *in, const Weight *add, const Weight *sub1,
+                     const Weight *sub2);
+
+    // out = in + add1 + add2 - sub1 - sub2, castling
+    void (*add2Sub2)(int16_t *out, const int16_t *in, const Weight *add1, const Weight *add2,
+                     const Weight *sub1, const Weight *sub2);
+};
+
+// All kernels work on hidden_size elements and give results identical to the scalar ones
+struct Kernels {
+    Isa isa;
+    const char *name;
+    int hidden_size;
+
+    UpdateKernels<int16_t> weights16;
+    UpdateKernels<int8_t> weights8;
+
+    // sum of relu(acc[i]) * weights[i]
+    int32_t (*dotRelu)(const int16_t *acc, const int16_t *weights);
+};
+
+// kernels used by the NNUE
+extern Kernels active;
+
+/// @brief the cpu and the compiler support the instruction set
+/// @param isa
+/// @return
+[[nodiscard]] bool supported(Isa isa);
+
+/// @brief kernels are compiled for every hidden size in HIDDEN_SIZES
+/// @param hidden_size
+/// @return
+[[nodiscard]] bool supportedHiddenSize(int hidden_size);
+
+/// @brief kernels of an instruction set and hidden size, check supported() before calling them.
+/// Exits if the hidden size is not in HIDDEN_SIZES.
+/// @param isa
+/// @param hidden_size
+/// @return
+[[nodiscard]] const Kernels &get(Isa isa, int hidden_size);
+
+/// @brief select the widest supported kernels of a hidden size
+/// @param hidden_size
+void init(int hidden_size);
+
+}  // namespace simd
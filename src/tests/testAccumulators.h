@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../uci.h"
+#include "tests.h"
+
+namespace tests {
+inline bool testAllAccumulators() {
+    Board board("r3k2r/1P6/8/8/8/8/6p1/R3K2R w KQkq - 0 1");
+
+    // castling, capture promotions and both kings crossing bucket boundaries
+    const std::vector<std::string> moves = {"e1c1", "e8g8", "b7a8q", "g2h1q", "c1b2", "g8g7",
+                                            "b2b3", "g7g6", "b3b4", "g6g5", "b4b5", "g5g4"};
+
+    std::vector<Move> played;
+
+    for (std::size_t i = 0; i < moves.size(); i++) {
+        played.push_back(uci::uciToMove(board, moves[i]));
+        board.makeMove<true>(played.back());
+
+        // skip plies, so that several pending changes are applied at once
+        if (i % 3 != 1 && i + 1 != moves.size()) continue;
+
+        Board fresh(board.getFen());
+
+        expect((board.getAccumulator() == fresh.getAccumulator()), true,
+               "Accumulator after " << moves[i]);
+    }
+
+    // unmaking keeps the computed accumulators of the parents
+    for (std::size_t i = played.size(); i-- > 1;) board.unmakeMove<false>(played[i]);
+
+    Board fresh(board.getFen());
+    expect((board.getAccumulator() == fresh.getAccumulator()), true, "Accumulator after unmake");
+
+    return true;
+}
+}  // namespace tests
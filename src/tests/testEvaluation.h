@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../benchmark.h"
+#include "../evaluation.h"
+#include "tests.h"
+
+namespace tests {
+inline bool testAllEvaluation() {
+    // more positions than fit into one chunk of the batch
+    std::vector<std::string> fens;
+    for (int i = 0; i < 3; i++) {
+        fens.insert(fens.end(), bench::benchmarkfens.begin(), bench::benchmarkfens.end());
+    }
+
+    Board batch_board;
+    std::vector<Score> scores;
+    eval::evaluate(batch_board, fens, scores);
+
+    expect(scores.size(), fens.size(), "Batch size");
+
+    for (std::size_t i = 0; i < fens.size(); i++) {
+        Board board(fens[i]);
+        expect(scores[i], eval::evaluate(board), "Batch evaluation of " << fens[i]);
+    }
+
+    // the board keeps the last position with a valid accumulator
+    Board last(fens.back());
+    expect(eval::evaluate(batch_board), eval::evaluate(last), "Board after the batch");
+
+    // cached evaluations are the same as computed ones, the halfmove scaling is not cached
+    EvalCache cache;
+    cache.validate();
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (const auto &fen : bench::benchmarkfens) {
+            Board board(fen);
+            expect(eval::evaluate(board, cache), eval::evaluate(board), "Cached evaluation");
+        }
+    }
+
+    expect(cache.stats.probes, 2 * bench::benchmarkfens.size(), "Eval cache probes");
+    expect(cache.stats.hits, bench::benchmarkfens.size(), "Eval cache hits");
+
+    Board reset_clock("8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 0 54");
+    Board late_clock("8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 90 54");
+    expect(eval::evaluate(reset_clock, cache), eval::evaluate(reset_clock), "Cached clock 0");
+    expect(eval::evaluate(late_clock, cache), eval::evaluate(late_clock), "Cached clock 90");
+
+    // a disabled cache never hits
+    EvalCache disabled;
+    disabled.resize(0);
+    disabled.validate();
+
+    Board board(bench::benchmarkfens[0]);
+    expect(eval::evaluate(board, disabled), eval::evaluate(board), "Disabled eval cache");
+    expect(eval::evaluate(board, disabled), eval::evaluate(board), "Disabled eval cache again");
+    expect(disabled.stats.hits, U64(0), "Disabled eval cache hits");
+
+    return true;
+}
+}  // namespace tests
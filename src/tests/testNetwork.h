@@ -0,0 +1,132 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+
+#include "../evaluation.h"
+#include "../nnue.h"
+#include "../uci.h"
+#include "tests.h"
+
+namespace tests {
+inline bool testAllNetwork() {
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::string saved = (dir / "smallbrain-test-saved.nnue").string();
+    const std::string raw = (dir / "smallbrain-test-raw.nnue").string();
+    const std::string small = (dir / "smallbrain-test-small.nnue").string();
+    const std::string small8 = (dir / "smallbrain-test-small-int8.nnue").string();
+    const std::string saved8 = (dir / "smallbrain-test-saved-int8.nnue").string();
+    const std::string corrupt = (dir / "smallbrain-test-corrupt.nnue").string();
+
+    const uint64_t embedded_hash = nnue::networkHash();
+    const std::string fen = "r3k2r/1P6/8/8/8/8/6p1/R3K2R w KQkq - 0 1";
+
+    Board reference(fen);
+    const Score embedded_score = eval::evaluate(reference);
+
+    // the embedded network written with a header loads to the same weights
+    expect(nnue::save(saved), true, "Save the embedded network");
+    expect(nnue::init(saved.c_str()), true, "Load the saved network");
+    expect(nnue::networkHash(), embedded_hash, "Hash of the saved network");
+
+    Board saved_board(fen);
+    expect(eval::evaluate(saved_board), embedded_score, "Evaluation with the saved network");
+
+    // a smaller network with random weights
+    const int hidden = 256;
+    {
+        std::ofstream file(raw, std::ios::binary);
+        uint32_t state = 0x9e3779b9;
+
+        for (int i = 0; i < BUCKETS * FEATURE_SIZE * hidden + 3 * hidden; i++) {
+            state = state * 1664525 + 1013904223;
+            const auto weight = static_cast<int16_t>((state >> 16) % 129 - 64);
+            file.write(reinterpret_cast<const char *>(&weight), sizeof(weight));
+        }
+
+        const int32_t output_bias = 12;
+        file.write(reinterpret_cast<const char *>(&output_bias), sizeof(output_bias));
+    }
+
+    expect(nnue::init(raw.c_str()), false, "A headerless network of another size is rejected");
+    expect(nnue::networkHash(), embedded_hash, "The rejected network is not used");
+
+    expect(nnue::convert(raw, small, hidden), true, "Convert the smaller network");
+    expect(nnue::init(small.c_str()), true, "Load the smaller network");
+    expect(nnue::hiddenSize(), hidden, "Hidden size of the smaller network");
+
+    // incremental updates of the smaller network match a refresh
+    Board board(fen);
+
+    const std::vector<std::string> moves = {"e1c1", "e8g8", "b7a8q", "g2h1q", "c1b2", "g8g7"};
+    std::vector<Score> small_scores;
+
+    for (const auto &move : moves) {
+        board.makeMove<true>(uci::uciToMove(board, move));
+
+        Board fresh(board.getFen());
+        expect(eval::evaluate(board), eval::evaluate(fresh), "Smaller network after " << move);
+        small_scores.push_back(eval::evaluate(fresh));
+    }
+
+    // the random weights fit into 8 bits without scaling, the quantized network is exact
+    expect(nnue::quantize(small, small8), true, "Quantize the smaller network");
+    expect(nnue::init(small8.c_str()), true, "Load the quantized smaller network");
+    expect(nnue::quantized(), true, "The smaller network is quantized");
+
+    Board board8(fen);
+
+    for (std::size_t i = 0; i < moves.size(); i++) {
+        board8.makeMove<true>(uci::uciToMove(board8, moves[i]));
+
+        Board fresh(board8.getFen());
+        expect(eval::evaluate(board8), small_scores[i], "Quantized network after " << moves[i]);
+        expect(eval::evaluate(fresh), small_scores[i], "Refreshed quantized network");
+    }
+
+    // the embedded network loses precision, but updates and refreshes still agree
+    expect(nnue::quantize(saved, saved8), true, "Quantize the embedded network");
+    expect(nnue::init(saved8.c_str()), true, "Load the quantized embedded network");
+    expect(nnue::quantized(), true, "The embedded network is quantized");
+
+    Board embedded8(fen);
+
+    for (const auto &move : moves) {
+        embedded8.makeMove<true>(uci::uciToMove(embedded8, move));
+
+        Board fresh(embedded8.getFen());
+        expect(eval::evaluate(embedded8), eval::evaluate(fresh),
+               "Quantized embedded network after " << move);
+    }
+
+    expect(nnue::init(small.c_str()), true, "Load the smaller network again");
+    const uint64_t small_hash = nnue::networkHash();
+
+    // a flipped bit in the weights is caught by the hash. A copy is corrupted, the loaded
+    // network is mapped from its file, which must not be modified.
+    std::filesystem::copy_file(small, corrupt, std::filesystem::copy_options::overwrite_existing);
+    {
+        std::fstream file(corrupt, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(sizeof(nnue::NetworkHeader) + 100);
+        file.put(0x55);
+    }
+
+    expect(nnue::init(corrupt.c_str()), false, "A corrupt network is rejected");
+    expect(nnue::networkHash(), small_hash, "The loaded network is kept");
+
+    Board kept(board.getFen());
+    expect(eval::evaluate(kept), small_scores.back(), "Evaluation with the kept network");
+
+    expect(nnue::init(""), true, "Load the embedded network");
+    expect(nnue::networkHash(), embedded_hash, "Hash of the embedded network");
+
+    std::filesystem::remove(saved);
+    std::filesystem::remove(raw);
+    std::filesystem::remove(small);
+    std::filesystem::remove(small8);
+    std::filesystem::remove(saved8);
+    std::filesystem::remove(corrupt);
+
+    return true;
+}
+}  // namespace tests
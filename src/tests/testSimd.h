@@ -0,0 +1,90 @@
+#pragma once
+
+#include "tests.h"
+#include "../simd.h"
+
+namespace tests {
+template <typename Weight>
+inline void testUpdateKernels(const simd::UpdateKernels<Weight> &scalar,
+                              const simd::UpdateKernels<Weight> &kernels, const std::string &name,
+                              const std::array<int16_t, MAX_HIDDEN_SIZE> &acc,
+                              const std::array<Weight, MAX_HIDDEN_SIZE> &add,
+                              const std::array<Weight, MAX_HIDDEN_SIZE> &sub) {
+    auto expected = acc;
+    auto got = acc;
+
+    scalar.add(expected.data(), add.data());
+    kernels.add(got.data(), add.data());
+    expect((got == expected), true, name << " add");
+
+    scalar.sub(expected.data(), sub.data());
+    kernels.sub(got.data(), sub.data());
+    expect((got == expected), true, name << " sub");
+
+    scalar.addSub(expected.data(), add.data(), sub.data());
+    kernels.addSub(got.data(), add.data(), sub.data());
+    expect((got == expected), true, name << " addSub");
+
+    // the fused kernels write into a separate child accumulator
+    auto expected_child = acc;
+    auto got_child = acc;
+
+    scalar.add1Sub1(expected_child.data(), expected.data(), add.data(), sub.data());
+    kernels.add1Sub1(got_child.data(), got.data(), add.data(), sub.data());
+    expect((got_child == expected_child), true, name << " add1Sub1");
+
+    scalar.add1Sub2(expected_child.data(), expected.data(), add.data(), sub.data(), add.data());
+    kernels.add1Sub2(got_child.data(), got.data(), add.data(), sub.data(), add.data());
+    expect((got_child == expected_child), true, name << " add1Sub2");
+
+    scalar.add2Sub2(expected_child.data(), expected.data(), add.data(), sub.data(), sub.data(),
+                    add.data());
+    kernels.add2Sub2(got_child.data(), got.data(), add.data(), sub.data(), sub.data(),
+                     add.data());
+    expect((got_child == expected_child), true, name << " add2Sub2");
+}
+
+inline bool testAllSimd() {
+    alignas(64) std::array<int16_t, MAX_HIDDEN_SIZE> acc = {};
+    alignas(64) std::array<int16_t, MAX_HIDDEN_SIZE> add = {};
+    alignas(64) std::array<int16_t, MAX_HIDDEN_SIZE> sub = {};
+    alignas(64) std::array<int8_t, MAX_HIDDEN_SIZE> add8 = {};
+    alignas(64) std::array<int8_t, MAX_HIDDEN_SIZE> sub8 = {};
+
+    uint32_t state = 0x9e3779b9;
+    const auto next = [&state]() {
+        state = state * 1664525 + 1013904223;
+        return static_cast<int16_t>((state >> 16) % 2001 - 1000);
+    };
+
+    for (int i = 0; i < MAX_HIDDEN_SIZE; i++) {
+        acc[i] = next();
+        add[i] = next();
+        sub[i] = next();
+        // the full int8 range, negative weights have to be sign extended
+        add8[i] = static_cast<int8_t>(next() % 128);
+        sub8[i] = static_cast<int8_t>(next() % 129);
+    }
+
+    // kernels of a smaller network leave the rest of the accumulator untouched like the scalar
+    // ones, so comparing whole arrays also catches writes past the hidden size
+    for (int hidden_size : HIDDEN_SIZES) {
+        const simd::Kernels &scalar = simd::get(simd::Isa::SCALAR, hidden_size);
+
+        for (simd::Isa isa : {simd::Isa::SSE2, simd::Isa::AVX2, simd::Isa::AVX512}) {
+            if (!simd::supported(isa)) continue;
+
+            const simd::Kernels &kernels = simd::get(isa, hidden_size);
+            const std::string name = kernels.name + std::string(" ") + std::to_string(hidden_size);
+
+            testUpdateKernels(scalar.weights16, kernels.weights16, name, acc, add, sub);
+            testUpdateKernels(scalar.weights8, kernels.weights8, name + " int8", acc, add8, sub8);
+
+            expect(kernels.dotRelu(acc.data(), add.data()), scalar.dotRelu(acc.data(), add.data()),
+                   name << " dotRelu");
+        }
+    }
+
+    return true;
+}
+}  // namespace tests
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "tests.h"
+#include "../tt.h"
+
+namespace tests {
+inline bool testAllTranspositionTable() {
+    TTable.clear();
+
+    const U64 key = 0x463b96181691fc9c;
+    const Move move = make(SQ_E2, SQ_E4);
+
+    Move ttmove = NO_MOVE;
+    bool tt_hit = false;
+
+    TTStats stats;
+
+    TTable.newSearch();
+    TTable.store(10, 25, EXACTBOUND, key, move, 17, &stats);
+
+    const TEntry *tte = TTable.probe(tt_hit, ttmove, key, &stats);
+    expect(tt_hit, true, "Store and probe");
+    expect(ttmove, move, "Store and probe move");
+    expect(tte->score, 25, "Store and probe score");
+    expect(tte->eval, 17, "Store and probe eval");
+
+    // an unknown eval keeps the cached one
+    TTable.store(12, 30, LOWERBOUND, key, move, VALUE_NONE, &stats);
+    expect(tte->eval, 17, "Unknown eval keeps cached eval");
+
+    // entries survive a full generation cycle within the same game
+    for (int i = 0; i < 100; i++) TTable.newSearch();
+
+    static_cast<void>(TTable.probe(tt_hit, ttmove, key, &stats));
+    expect(tt_hit, true, "Probe after many searches");
+
+    // a new game makes all previous entries stale
+    TTable.newGame();
+
+    static_cast<void>(TTable.probe(tt_hit, ttmove, key, &stats));
+    expect(tt_hit, false, "Probe after new game");
+    expect(TTable.hashfull(), 0, "Hashfull after new game");
+
+    TTable.newSearch();
+    TTable.store(4, -10, UPPERBOUND, key, NO_MOVE, VALUE_NONE, &stats);
+
+    tte = TTable.probe(tt_hit, ttmove, key, &stats);
+    expect(tt_hit, true, "Store after new game");
+    expect(ttmove, NO_MOVE, "Stale move is not kept");
+    expect(tte->flag(), UPPERBOUND, "Store after new game bound");
+
+    expect(stats.probes, 4, "Stats probes");
+    expect(stats.hits, 3, "Stats hits");
+    expect(stats.stores_empty, 2, "Stats stores into empty slots");
+    expect(stats.stores_same, 1, "Stats stores of the same position");
+
+    // without counters the table works the same and nothing is counted
+    TTable.store(4, -10, UPPERBOUND, key, NO_MOVE, VALUE_NONE, nullptr);
+    static_cast<void>(TTable.probe(tt_hit, ttmove, key, nullptr));
+    expect(tt_hit, true, "Probe without stats");
+    expect(stats.probes, 4, "Stats probes without stats");
+
+    TTable.clear();
+
+    // resizing keeps the entries, compact ones are dropped
+    const auto nextKey = [](U64 &state) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+
+    U64 state = key;
+    for (int i = 0; i < 1000; i++) {
+        TTable.store(i % 20, i, EXACTBOUND, nextKey(state), move, 0, &stats);
+    }
+
+#ifdef TT_COMPACT
+    expect(TTable.resize(TTable.clusters() * 3, 2), U64(0), "Compact resize drops all entries");
+
+    state = key;
+    int found = 0;
+    for (int i = 0; i < 1000; i++) {
+        static_cast<void>(TTable.probe(tt_hit, ttmove, nextKey(state), &stats));
+        found += tt_hit;
+    }
+
+    expect(found, 0, "Probe after compact resize");
+#else
+    expect(TTable.resize(TTable.clusters() * 3, 2), 1000, "Resize keeps all entries");
+
+    state = key;
+    int found = 0;
+    for (int i = 0; i < 1000; i++) {
+        tte = TTable.probe(tt_hit, ttmove, nextKey(state), &stats);
+        found += tt_hit && tte->score == i;
+    }
+
+    expect(found, 1000, "Probe after resize");
+
+    expect(TTable.resize(1, 2), U64(TCluster::SIZE), "Resize to a single cluster");
+
+    // only the deepest entries are left
+    state = key;
+    int deepest = 0;
+    for (int i = 0; i < 1000; i++) {
+        tte = TTable.probe(tt_hit, ttmove, nextKey(state), &stats);
+        deepest += tt_hit && tte->depth == 19;
+    }
+
+    expect(deepest, TCluster::SIZE, "Resize keeps the deepest entries");
+#endif
+
+    TTable.allocateMB(16);
+    TTable.clear();
+
+#ifndef _WIN32
+    // tables attached to the same segment share their entries
+    {
+        const std::string segment = "/smallbrain-test-shared-hash";
+
+        // left behind if an earlier run crashed
+        memory::unlinkShared(segment);
+
+        TranspositionTable first;
+        TranspositionTable second;
+
+        expect(first.attach(segment, 1), true, "Create shared hash");
+        expect(second.attach(segment, 8), true, "Attach shared hash");
+        expect(second.sizeMB(), 1, "Attached shared hash keeps its size");
+
+        first.newSearch();
+        first.store(7, 42, LOWERBOUND, key, move, 3, &stats);
+
+        tte = second.probe(tt_hit, ttmove, key, &stats);
+        expect(tt_hit, true, "Probe shared hash");
+        expect(tte->score, 42, "Probe shared hash score");
+
+        // the segment is removed once the last table detached
+        second.detach();
+        first.detach();
+
+        expect(first.attach(segment, 1), true, "Create shared hash again");
+        static_cast<void>(first.probe(tt_hit, ttmove, key, &stats));
+        expect(tt_hit, false, "Probe new shared hash");
+    }
+#endif
+
+    return true;
+}
+}  // namespace tests
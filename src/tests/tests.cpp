@@ -1,6 +1,11 @@
 #include "tests.h"
+#include "testAccumulators.h"
 #include "testDraw.h"
+#include "testEvaluation.h"
 #include "testFenRepetition.h"
+#include "testNetwork.h"
+#include "testSimd.h"
+#include "testTranspositionTable.h"
 #include "testZobristHash.h"
 
 namespace tests {
@@ -13,6 +18,16 @@ bool testall() {
     testAllZobristHash();
     std::cout << "Running testAllDraw" << std::endl;
     testAllDraw();
+    std::cout << "Running testAllTranspositionTable" << std::endl;
+    testAllTranspositionTable();
+    std::cout << "Running testAllSimd" << std::endl;
+    testAllSimd();
+    std::cout << "Running testAllAccumulators" << std::endl;
+    testAllAccumulators();
+    std::cout << "Running testAllEvaluation" << std::endl;
+    testAllEvaluation();
+    std::cout << "Running testAllNetwork" << std::endl;
+    testAllNetwork();
 
     std::cout << "Tests run successfully" << std::endl;
     return true;
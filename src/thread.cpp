@@ -1,8 +1,63 @@
+#include <algorithm>
+#include <cassert>
 #include <iostream>
+#include <unordered_map>
 
 #include "thread.h"
 
-void SearchInstance::start() const { search->startThinking(); }
+#include "numa.h"
+
+Worker::Worker() : thread_(&Worker::idleLoop, this) {}
+
+Worker::~Worker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exit_ = true;
+    }
+
+    cv_.notify_all();
+    thread_.join();
+}
+
+void Worker::run(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(!busy_);
+
+        job_ = std::move(job);
+        busy_ = true;
+    }
+
+    cv_.notify_all();
+}
+
+void Worker::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !busy_; });
+}
+
+void Worker::idleLoop() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return busy_ || exit_; });
+
+        if (exit_) return;
+
+        lock.unlock();
+        job_();
+        lock.lock();
+
+        busy_ = false;
+        lock.unlock();
+
+        cv_.notify_all();
+    }
+}
+
+void SearchInstance::start() const {
+    numa::bindThread(search->id);
+    search->startThinking();
+}
 
 U64 ThreadPool::getNodes() const {
     U64 total = 0;
@@ -24,52 +79,164 @@ U64 ThreadPool::getTbHits() const {
     return total;
 }
 
+TTStats ThreadPool::getTTStats() const {
+    TTStats total;
+
+    for (auto &th : pool_) {
+        total += th.search->tt_stats;
+    }
+
+    return total;
+}
+
+EvalCache::Stats ThreadPool::getEvalCacheStats() const {
+    EvalCache::Stats total;
+
+    for (auto &th : pool_) {
+        total += th.search->eval_cache.stats;
+    }
+
+    return total;
+}
+
 void ThreadPool::start(const Board &board, const Limits &limit, const Movelist &searchmoves,
                        int worker_count, bool use_tb) {
-    assert(running_threads_.size() == 0);
+    assert(running_ == 0);
 
     stop = false;
 
-    SearchInstance mainThread;
-
-    if (!pool_.empty()) mainThread = pool_[0];
+    TTable.newSearch();
 
-    pool_.clear();
+    // the search data of a new thread is first touched on the node it is going to run on
+    while (static_cast<int>(pool_.size()) < worker_count) {
+        numa::bindThread(static_cast<int>(pool_.size()));
+        pool_.emplace_back();
+    }
 
-    // update with info
-    mainThread.search->id = 0;
-    mainThread.search->board = board;
-    mainThread.search->limit = limit;
-    mainThread.search->use_tb = use_tb;
-    mainThread.search->nodes = 0;
-    mainThread.search->tbhits = 0;
-    mainThread.search->node_effort.reset();
-    mainThread.search->searchmoves = searchmoves;
+    numa::unbindThread();
 
-    pool_.emplace_back(mainThread);
+    pool_.resize(worker_count);
 
-    // start at index 1 to keep "mainthread" data alive
-    mainThread.search->consthist.reset();
-    mainThread.search->history.reset();
-    mainThread.search->counters.reset();
+    const Search &main_search = *pool_[0].search;
 
-    for (int i = 1; i < worker_count; i++) {
-        mainThread.search->id = i;
+    for (int i = 0; i < worker_count; i++) {
+        Search &search = *pool_[i].search;
+
+        if (helper_history_ == HelperHistory::RESET) {
+            search.reset();
+        } else if (i > 0 && helper_history_ == HelperHistory::INHERIT) {
+            search.consthist = main_search.consthist;
+            search.history = main_search.history;
+            search.counters = main_search.counters;
+            search.killers = main_search.killers;
+        }
+
+        search.nodes = 0;
+        search.tbhits = 0;
+        search.evals_saved = 0;
+        search.tt_stats = TTStats();
+        search.collect_tt_stats = tt_stats_;
+        search.eval_cache.stats = EvalCache::Stats();
+        search.node_effort.reset();
+
+        search.id = i;
+        search.board.setPosition(board);
+        search.limit = limit;
+        search.use_tb = use_tb;
+        search.searchmoves = searchmoves;
+        search.eval_cache.resize(eval_cache_kb_);
+    }
 
-        pool_.emplace_back(mainThread);
+    while (static_cast<int>(workers_.size()) < worker_count) {
+        workers_.emplace_back(std::make_unique<Worker>());
     }
 
+    running_ = worker_count;
+
     for (int i = 0; i < worker_count; i++) {
-        running_threads_.emplace_back(&SearchInstance::start, std::ref(pool_[i]));
+        workers_[i]->run([this, i] { pool_[i].start(); });
     }
 }
 
-void ThreadPool::kill() {
-    stop = true;
+void ThreadPool::stopSearch() {
+    {
+        // a thread which just checked stop in waitForStop is already waiting for the signal
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stop = true;
+    }
+
+    stop_cv_.notify_all();
+}
+
+void ThreadPool::waitForStop() {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_cv_.wait(lock, [this] { return stop.load(); });
+}
+
+const Search &ThreadPool::bestThread(const Search &main_search) {
+    if (pool_.empty() || pool_[0].search.get() != &main_search) return main_search;
+
+    stopSearch();
+
+    for (int i = 1; i < running_; i++) workers_[i]->wait();
+
+    if (!voting_ || running_ == 1 || main_search.completed_depth == 0) return main_search;
+
+    Score min_score = VALUE_INFINITE;
+
+    for (int i = 0; i < running_; i++) {
+        const Search &search = *pool_[i].search;
+        if (search.completed_depth > 0)
+            min_score = std::min(min_score, search.completed_result.score);
+    }
+
+    std::unordered_map<Move, int64_t> votes;
 
-    for (auto &th : running_threads_)
-        if (th.joinable()) th.join();
+    for (int i = 0; i < running_; i++) {
+        const Search &search = *pool_[i].search;
+        if (search.completed_depth == 0) continue;
+
+        votes[search.completed_result.bestmove] +=
+            int64_t(search.completed_result.score - min_score + 14) * search.completed_depth;
+    }
+
+    const Search *best = &main_search;
+
+    for (int i = 1; i < running_; i++) {
+        const Search &search = *pool_[i].search;
+        if (search.completed_depth == 0) continue;
+
+        const Score score = search.completed_result.score;
+        const Score best_score = best->completed_result.score;
+
+        // a proven result is only replaced by a better proven one, e.g. a shorter mate
+        if (std::abs(best_score) >= VALUE_TB_WIN_IN_MAX_PLY) {
+            if (score > best_score) best = &search;
+        } else if (score >= VALUE_TB_WIN_IN_MAX_PLY ||
+                   (score > VALUE_TB_LOSS_IN_MAX_PLY &&
+                    votes[search.completed_result.bestmove] >
+                        votes[best->completed_result.bestmove])) {
+            best = &search;
+        }
+    }
+
+    return *best;
+}
+
+void ThreadPool::clear() {
+    assert(running_ == 0);
+
+    for (auto &th : pool_) th.search->reset();
+}
+
+void ThreadPool::wait() {
+    for (int i = 0; i < running_; i++) workers_[i]->wait();
+
+    running_ = 0;
+}
+
+void ThreadPool::kill() {
+    stopSearch();
 
-    pool_.clear();
-    running_threads_.clear();
+    wait();
 }
@@ -1,29 +1,35 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <thread>
 #include <vector>
 
 #include "search.h"
 
-// A wrapper class to start the search
+// Move ordering tables (history, continuation history, counter moves and killers)
+// the threads start a search with. The mainthread keeps its tables of the previous search
+// unless they are reset.
+enum class HelperHistory {
+    INHERIT,     // helpers get a copy of the mainthread's tables
+    PERSISTENT,  // every thread keeps its own tables of the previous search
+    RESET        // every thread starts with empty tables
+};
+
+// A wrapper class to start the search. The search data of a thread lives as long as the
+// thread pool uses it and is never copied, only moved when the pool grows.
 class SearchInstance {
 public:
     SearchInstance() { search = std::make_unique<Search>(); }
 
-    SearchInstance(const SearchInstance &other) {
-        search = std::make_unique<Search>(*other.search);
-    }
+    SearchInstance(const SearchInstance &other) = delete;
+    SearchInstance &operator=(const SearchInstance &other) = delete;
 
-    SearchInstance &operator=(const SearchInstance &other) {
-        // protect against invalid self-assignment
-        if (this != &other) {
-            search = std::make_unique<Search>(*other.search);
-        }
-        // by convention, always return *this
-        return *this;
-    }
+    SearchInstance(SearchInstance &&other) noexcept = default;
+    SearchInstance &operator=(SearchInstance &&other) noexcept = default;
 
     ~SearchInstance() = default;
 
@@ -32,21 +38,116 @@ public:
     std::unique_ptr<Search> search;
 };
 
-// Holds all currently running threads and their data
+// A long lived thread which sleeps until it is given a job
+class Worker {
+public:
+    Worker();
+    ~Worker();
+
+    Worker(const Worker &) = delete;
+    Worker &operator=(const Worker &) = delete;
+
+    /// @brief wake the thread up to run the job, the previous job has to be finished
+    /// @param job
+    void run(std::function<void()> job);
+
+    /// @brief block until the current job is finished
+    void wait();
+
+private:
+    void idleLoop();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::function<void()> job_;
+    bool busy_ = false;
+    bool exit_ = false;
+
+    // started last, the members above are initialized before the thread uses them
+    std::thread thread_;
+};
+
+// Holds the search threads and their data. The threads are created once and sleep between
+// searches, only the search data is handed over on every go.
 class ThreadPool {
 public:
     [[nodiscard]] U64 getNodes() const;
 
     [[nodiscard]] U64 getTbHits() const;
 
+    [[nodiscard]] TTStats getTTStats() const;
+
+    [[nodiscard]] EvalCache::Stats getEvalCacheStats() const;
+
+    /// @brief size of the eval cache of every search thread, applied with the next start
+    /// @param size_kb KiB per thread, 0 disables the cache
+    void setEvalCacheSize(int size_kb) { eval_cache_kb_ = size_kb; }
+
+    /// @brief collect TT usage counters in the next searches, off by default
+    void setTTStats(bool enabled) { tt_stats_ = enabled; }
+
+    /// @brief hand the root position and limits to worker_count threads and start them
     void start(const Board &board, const Limits &limit, const Movelist &searchmoves,
                int worker_count, bool use_tb);
 
+    /// @brief forget the history tables of every thread, used for a new game
+    void clear();
+
+    /// @brief how the threads seed their move ordering tables, applied with the next start
+    void setHelperHistory(HelperHistory mode) { helper_history_ = mode; }
+
+    /// @brief let helpers skip depths to diversify the search (off by default)
+    void setDepthSkipping(bool enabled) { depth_skipping_ = enabled; }
+
+    [[nodiscard]] bool depthSkipping() const { return depth_skipping_; }
+
+    /// @brief let the threads vote for the move which is played (off by default)
+    void setVoting(bool enabled) { voting_ = enabled; }
+
+    [[nodiscard]] bool voting() const { return voting_; }
+
+    /// @brief called by the mainthread when it finished, stops the helpers and waits for them.
+    /// Every thread votes for the best move of its last completed iteration, weighted by its
+    /// depth and score, the thread with the most votes for its move is returned.
+    /// A search outside of the pool or without voting returns main_search.
+    /// @param main_search
+    /// @return
+    [[nodiscard]] const Search &bestThread(const Search &main_search);
+
+    /// @brief wait until every thread finished its search, without stopping them
+    void wait();
+
+    /// @brief stop the search and wait for the threads
     void kill();
 
+    /// @brief set stop and wake up the threads which wait for it
+    void stopSearch();
+
+    /// @brief block the calling thread until the search is stopped, used by searches which
+    /// finished before an infinite search was stopped
+    void waitForStop();
+
+    // only set to true through stopSearch, which wakes up the waiting threads
     std::atomic_bool stop;
 
 private:
     std::vector<SearchInstance> pool_;
-    std::vector<std::thread> running_threads_;
+
+    // grows to the largest number of threads used so far, unused ones keep sleeping
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    // threads which take part in the current search
+    int running_ = 0;
+
+    int eval_cache_kb_ = EvalCache::DEFAULT_SIZE_KB;
+
+    bool tt_stats_ = false;
+
+    HelperHistory helper_history_ = HelperHistory::INHERIT;
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+
+    bool depth_skipping_ = false;
+    bool voting_ = false;
 };
\ No newline at end of file
@@ -1,51 +1,625 @@
 #include "tt.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "nnue.h"
+#include "numa.h"
+
+namespace {
+
+// Header of a TT snapshot, the raw clusters follow directly after it
+struct alignas(64) TTFileHeader {
+    char magic[8] = {'S', 'B', 'T', 'T', 'A', 'B', 'L', 'E'};
+    uint32_t version = 1;
+
+    // entry format, snapshots of a different build are rejected
+    uint32_t entry_size = sizeof(TEntry);
+    uint32_t key_size = sizeof(TKey);
+    uint32_t cluster_size = TCluster::SIZE;
+
+    U64 size_mb = 0;
+    U64 clusters = 0;
+
+    // stored evals and scores depend on the network
+    U64 network = 0;
+
+    uint8_t generation = 0;
+    uint8_t epoch = 0;
+};
+
+/// @brief split [0, size) into one slice per thread and run func(thread, start, length) on each
+template <typename Func>
+int parallelFor(U64 size, int threads, Func &&func) {
+    threads = std::clamp(threads, 1, static_cast<int>(std::min(size, U64(256))));
+
+    const U64 chunk = size / threads;
+
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < threads; i++) {
+        const U64 start = chunk * i;
+        const U64 length = i == threads - 1 ? size - start : chunk;
+
+        workers.emplace_back(func, i, start, length);
+    }
+
+    for (auto &worker : workers) worker.join();
+
+    return threads;
+}
+
+}  // namespace
+
+// Lives at the start of a shared segment, the clusters follow directly after it.
+// The entries themselves use the same lockless protocol as the threads of one process.
+struct alignas(64) TTSharedHeader {
+    static constexpr uint32_t MAGIC = 0x53425454;  // "SBTT"
+
+    // written last by the process which created the segment
+    std::atomic<uint32_t> ready = 0;
+
+    uint32_t entry_size = sizeof(TEntry);
+    uint32_t key_size = sizeof(TKey);
+    uint32_t cluster_size = TCluster::SIZE;
+
+    U64 size_mb = 0;
+    U64 clusters = 0;
+
+    std::atomic<uint32_t> attached = 0;
+
+    // Advanced by every search of every process. The processes do not share an epoch,
+    // each one keeps the entries of all generations valid.
+    std::atomic<uint8_t> generation = 0;
+};
+
+static_assert(sizeof(TTSharedHeader) % alignof(TCluster) == 0);
+
+TTStats &TTStats::operator+=(const TTStats &other) {
+    probes += other.probes;
+    hits += other.hits;
+    cutoffs += other.cutoffs;
+    collisions += other.collisions;
+    stores_empty += other.stores_empty;
+    stores_same += other.stores_same;
+    evictions_aged += other.evictions_aged;
+    evictions_depth += other.evictions_depth;
+
+    for (size_t i = 0; i < hit_ages.size(); i++) hit_ages[i] += other.hit_ages[i];
+
+    return *this;
+}
+
+std::string TTStats::summary() const {
+    const auto percent = [](U64 part, U64 total) { return total ? part * 100.0 / total : 0.0; };
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+
+    const U64 stores = stores_empty + stores_same + evictions_aged + evictions_depth;
+
+    // clang-format off
+    ss << "tt probes "     << probes
+       << " hits "         << hits         << " (" << percent(hits, probes) << "%)"
+       << " cutoffs "      << cutoffs      << " (" << percent(cutoffs, probes) << "%)"
+       << " collisions "   << collisions   << " (" << percent(collisions, probes) << "%)"
+       << " stores "       << stores
+       << " empty "        << stores_empty
+       << " same "         << stores_same
+       << " aged "         << evictions_aged
+       << " shallower "    << evictions_depth
+       << " hit ages";
+    // clang-format on
+
+    for (size_t i = 0; i < hit_ages.size(); i++) {
+        ss << " " << i << (i + 1 == hit_ages.size() ? "+:" : ":") << hit_ages[i];
+    }
+
+    return ss.str();
+}
+
 TranspositionTable::TranspositionTable() { allocateMB(16); }
 
-void TranspositionTable::store(int depth, Score bestvalue, Flag b, U64 key, Move move) {
-    TEntry *tte = &entries_[index(key)];
+TranspositionTable::~TranspositionTable() { release(); }
+
+void TranspositionTable::store(int depth, Score bestvalue, Flag b, U64 key, Move move,
+                               Score eval, TTStats *stats) {
+    TCluster &cluster = entries_[index(key)];
+    TEntry *tte = &cluster.entries[0];
+
+    const TKey tt_key = TEntry::verification(key);
+
+    // Pick the entry of the same position or an empty slot, otherwise replace
+    // the entry which is the least valuable by depth and age.
+    for (auto &entry : cluster.entries) {
+        if (entry.key == tt_key || isEmpty(entry)) {
+            tte = &entry;
+            break;
+        }
+
+        if (replaceValue(entry) < replaceValue(*tte)) tte = &entry;
+    }
 
-    if (tte->key != key || move) tte->move = move;
+    const bool same_position = tte->key == tt_key && !isEmpty(*tte);
 
-    if (tte->key != key || b == EXACTBOUND || depth + 4 > tte->depth) {
+    if (stats != nullptr) {
+        if (same_position)
+            stats->stores_same++;
+        else if (isEmpty(*tte))
+            stats->stores_empty++;
+        else if (relativeAge(*tte))
+            stats->evictions_aged++;
+        else
+            stats->evictions_depth++;
+    }
+
+    if (!same_position || move) tte->move = move;
+
+    if (!same_position || eval != VALUE_NONE) tte->eval = eval;
+
+    if (!same_position || b == EXACTBOUND || depth + 4 > tte->depth || relativeAge(*tte)) {
         tte->depth = depth;
         tte->score = bestvalue;
-        tte->key = key;
-        tte->flag = b;
+        tte->key = tt_key;
+        tte->age_bound = generation_ | b;
     }
 }
 
-const TEntry *TranspositionTable::probe(bool &tt_hit, Move &ttmove, U64 key) const {
-    const TEntry *tte = &entries_[index(key)];
-    tt_hit = (tte->key == key);
-    ttmove = tte->move;
-    return tte;
+const TEntry *TranspositionTable::probe(bool &tt_hit, Move &ttmove, U64 key, TTStats *stats) {
+    TCluster &cluster = entries_[index(key)];
+
+    const TKey tt_key = TEntry::verification(key);
+
+    if (stats != nullptr) stats->probes++;
+
+    for (auto &entry : cluster.entries) {
+        if (entry.key == tt_key && !isEmpty(entry)) {
+            if (stats != nullptr) {
+                stats->hits++;
+                stats->hit_ages[std::min(relativeAge(entry), int(stats->hit_ages.size() - 1))]++;
+            }
+
+            // refresh the generation so the entry survives the next replacement
+            if (entry.generation() != generation_) entry.age_bound = generation_ | entry.flag();
+
+            tt_hit = true;
+            ttmove = entry.move;
+            return &entry;
+        }
+    }
+
+    if (stats != nullptr) {
+        stats->collisions += std::any_of(cluster.entries.begin(), cluster.entries.end(),
+                                         [this](const TEntry &entry) { return !isEmpty(entry); });
+    }
+
+    tt_hit = false;
+    ttmove = NO_MOVE;
+    return &cluster.entries[0];
 }
 
 uint32_t TranspositionTable::index(U64 key) const {
 #ifdef __SIZEOF_INT128__
-    return (uint64_t)(((__uint128_t)key * (__uint128_t)entries_.size()) >> 64);
+    return (uint64_t)(((__uint128_t)key * (__uint128_t)size_) >> 64);
 #else
-    return key % entries_.size();
+    return key % size_;
 #endif
 }
 
-void TranspositionTable::allocate(U64 size) { entries_.resize(size, TEntry()); }
+void TranspositionTable::allocate(U64 size, int threads) {
+    size = std::max(size, U64(1));
+
+    const auto t0 = TimePoint::now();
+
+    memory::free(memory_);
+    memory_ = memory::allocLargePages(size * sizeof(TCluster));
+
+    if (memory_.ptr == nullptr) {
+        std::cout << "info string failed to allocate " << size * sizeof(TCluster)
+                  << " bytes for the hash table" << std::endl;
+        std::exit(1);
+    }
 
-void TranspositionTable::allocateMB(U64 size_mb) {
+    entries_ = static_cast<TCluster *>(memory_.ptr);
+    size_ = size;
+
+    const auto t1 = TimePoint::now();
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+    std::cout << "info string hash allocated in " << ms << " ms"
+              << (memory_.huge_pages ? " using huge pages" : "") << std::endl;
+
+    clear(threads);
+}
+
+U64 TranspositionTable::clustersMB(U64 size_mb) {
     U64 sizeB = size_mb * static_cast<int>(1e6);
     sizeB = std::clamp(sizeB, U64(1), U64(MAXHASH_MiB * 1e6));
-    U64 elements = sizeB / sizeof(TEntry);
-    allocate(elements);
-    std::cout << "hash set to " << sizeB / 1e6 << " MB" << std::endl;
+    return std::max(sizeB / sizeof(TCluster), U64(1));
+}
+
+U64 TranspositionTable::resize(U64 size, int threads) {
+    if (sizeFixed()) return 0;
+
+    size = std::max(size, U64(1));
+
+#ifdef TT_COMPACT
+    // A compact entry only stores the lower 16 bits of its key, its cluster in a table of
+    // another size is unknown. Rehashed entries would be misplaced and never found again.
+    allocate(size, threads);
+
+    std::cout << "info string hash resized, compact entries can not be rehashed and were dropped"
+              << std::endl;
+
+    return 0;
+#else
+    const auto t0 = TimePoint::now();
+
+    memory::Block new_memory = memory::allocLargePages(size * sizeof(TCluster));
+
+    if (new_memory.ptr == nullptr) {
+        std::cout << "info string failed to allocate " << size * sizeof(TCluster)
+                  << " bytes for the hash table" << std::endl;
+        std::exit(1);
+    }
+
+    auto *new_entries = static_cast<TCluster *>(new_memory.ptr);
+
+    if (numa::active()) threads = std::max(threads, static_cast<int>(numa::nodes().size()));
+
+    std::array<U64, 256> found = {};
+    std::array<U64, 256> kept = {};
+
+    // Every thread owns a slice of the new table, so no two threads write to the same cluster.
+    // The cluster index grows with the key, which limits the old clusters a slice is filled from.
+    threads = parallelFor(size, threads, [&](int thread, U64 start, U64 length) {
+        numa::bindThread(thread);
+        std::memset(static_cast<void *>(&new_entries[start]), 0, length * sizeof(TCluster));
+
+#ifdef __SIZEOF_INT128__
+        const U64 first = (uint64_t)(((__uint128_t)start * size_) / size);
+        const U64 last =
+            std::min(size_, U64(((__uint128_t)(start + length) * size_ + size - 1) / size + 1));
+#else
+        const U64 first = 0;
+        const U64 last = size_;
+#endif
+
+        for (U64 i = first; i < last; i++) {
+            for (const auto &entry : entries_[i].entries) {
+                if (isEmpty(entry)) continue;
+
+                const U64 key = entry.key;
+#ifdef __SIZEOF_INT128__
+                const U64 target = (uint64_t)(((__uint128_t)key * (__uint128_t)size) >> 64);
+#else
+                const U64 target = key % size;
+#endif
+
+                if (target < start || target >= start + length) continue;
+
+                found[thread]++;
+
+                TEntry *slot = &new_entries[target].entries[0];
+
+                for (auto &candidate : new_entries[target].entries) {
+                    if (isEmpty(candidate)) {
+                        slot = &candidate;
+                        break;
+                    }
+
+                    if (replaceValue(candidate) < replaceValue(*slot)) slot = &candidate;
+                }
+
+                if (isEmpty(*slot) || replaceValue(entry) > replaceValue(*slot)) *slot = entry;
+            }
+        }
+
+        for (U64 i = start; i < start + length; i++) {
+            for (const auto &entry : new_entries[i].entries) kept[thread] += !isEmpty(entry);
+        }
+    });
+
+    memory::free(memory_);
+
+    memory_ = new_memory;
+    entries_ = new_entries;
+    size_ = size;
+
+    const U64 total_found = std::accumulate(found.begin(), found.end(), U64(0));
+    const U64 total_kept = std::accumulate(kept.begin(), kept.end(), U64(0));
+
+    const auto t1 = TimePoint::now();
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+    std::cout << "info string hash resized in " << ms << " ms using " << threads
+              << " threads, kept " << total_kept << " of " << total_found << " entries"
+              << std::endl;
+
+    return total_kept;
+#endif
+}
+
+void TranspositionTable::allocateMB(U64 size_mb, int threads) {
+    const U64 elements = clustersMB(size_mb);
+
+    if (elements == size_ || sizeFixed()) return;
+
+    size_mb_ = size_mb;
+
+    if (entries_ == nullptr)
+        allocate(elements, threads);
+    else
+        static_cast<void>(resize(elements, threads));
+    std::cout << "hash set to " << elements * sizeof(TCluster) / 1e6 << " MB" << std::endl;
+}
+
+void TranspositionTable::clear(int threads) {
+    const auto t0 = TimePoint::now();
+
+    // Every thread zeroes its own slice, the first touch places the pages on the node of the
+    // thread. With NUMA every node gets at least one thread, so the table is striped across them.
+    if (numa::active()) threads = std::max(threads, static_cast<int>(numa::nodes().size()));
+
+    threads = parallelFor(size_, threads, [this](int thread, U64 start, U64 length) {
+        numa::bindThread(thread);
+        std::memset(static_cast<void *>(&entries_[start]), 0, length * sizeof(TCluster));
+    });
+
+    generation_ = 0;
+    epoch_ = 0;
+
+    if (shared_ != nullptr) {
+        shared_->generation = 0;
+        epoch_ = GENERATION_DELTA;
+    }
+
+    const auto t1 = TimePoint::now();
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+    std::cout << "info string hash cleared in " << ms << " ms using " << threads << " threads"
+              << std::endl;
 }
 
-void TranspositionTable::clear() { std::fill(entries_.begin(), entries_.end(), TEntry()); }
+bool TranspositionTable::save(const std::string &path) const {
+    TTFileHeader header;
+    header.size_mb = size_mb_;
+    header.clusters = size_;
+    header.network = nnue::networkHash();
+    header.generation = generation_;
+    header.epoch = epoch_;
+
+    std::ofstream file(path, std::ios::binary);
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries_), size_ * sizeof(TCluster));
+
+    if (!file) {
+        std::cout << "info string failed to write hash file " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "info string saved hash to " << path << std::endl;
+    return true;
+}
+
+bool TranspositionTable::load(const std::string &path, int threads) {
+    memory::Block block = memory::mapFile(path);
+
+    if (block.ptr == nullptr || block.size < sizeof(TTFileHeader)) {
+        std::cout << "info string failed to read hash file " << path << std::endl;
+        memory::free(block);
+        return false;
+    }
+
+    const auto t0 = TimePoint::now();
+
+    TTFileHeader header;
+    const TTFileHeader expected;
+
+    std::memcpy(&header, block.ptr, sizeof(header));
+
+    const char *reason = nullptr;
+
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+        header.version != expected.version)
+        reason = "not a hash file";
+    else if (header.entry_size != expected.entry_size || header.key_size != expected.key_size ||
+             header.cluster_size != expected.cluster_size)
+        reason = "different entry format";
+    else if (header.network != nnue::networkHash())
+        reason = "different network";
+    else if (header.clusters != clustersMB(header.size_mb) ||
+             block.size != sizeof(header) + header.clusters * sizeof(TCluster))
+        reason = "truncated file";
+    else if (shared_ != nullptr && header.clusters != size_)
+        reason = "different size than the shared segment";
+
+    if (reason != nullptr) {
+        std::cout << "info string rejected hash file " << path << ": " << reason << std::endl;
+        memory::free(block);
+        return false;
+    }
+
+    // the content is overwritten, there is nothing to keep
+    if (header.clusters != size_) allocate(header.clusters, threads);
+
+    size_mb_ = header.size_mb;
+
+    const auto *clusters =
+        reinterpret_cast<const TCluster *>(static_cast<const char *>(block.ptr) + sizeof(header));
+
+    parallelFor(size_, threads, [this, clusters](int, U64 start, U64 length) {
+        std::memcpy(static_cast<void *>(&entries_[start]), &clusters[start],
+                    length * sizeof(TCluster));
+    });
+
+    generation_ = header.generation;
+    epoch_ = header.epoch;
+
+    if (shared_ != nullptr) {
+        shared_->generation = generation_;
+        epoch_ = generation_ + GENERATION_DELTA;
+    }
+
+    memory::free(block);
+
+    const auto t1 = TimePoint::now();
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+    std::cout << "info string loaded hash from " << path << " in " << ms << " ms" << std::endl;
+    return true;
+}
+
+bool TranspositionTable::attach(const std::string &name, U64 size_mb, int threads) {
+    const U64 clusters = clustersMB(size_mb);
+
+    bool created = false;
+    memory::Block block =
+        memory::mapShared(name, sizeof(TTSharedHeader) + clusters * sizeof(TCluster), created);
+
+    if (block.ptr == nullptr || block.size < sizeof(TTSharedHeader)) {
+        std::cout << "info string failed to attach shared hash " << name << std::endl;
+        memory::free(block);
+        return false;
+    }
+
+    TTSharedHeader *header = created ? new (block.ptr) TTSharedHeader()
+                                     : static_cast<TTSharedHeader *>(block.ptr);
+    auto *clusters_ptr =
+        reinterpret_cast<TCluster *>(static_cast<char *>(block.ptr) + sizeof(TTSharedHeader));
+
+    if (created) {
+        header->size_mb = size_mb;
+        header->clusters = clusters;
+    } else {
+        // the creator clears the table before it marks the segment as ready
+        for (int i = 0; i < 10000 && header->ready != TTSharedHeader::MAGIC; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    const TTSharedHeader expected;
+    const char *reason = nullptr;
+
+    if (!created && header->ready != TTSharedHeader::MAGIC)
+        reason = "not a hash segment";
+    else if (header->entry_size != expected.entry_size ||
+             header->key_size != expected.key_size ||
+             header->cluster_size != expected.cluster_size)
+        reason = "different entry format";
+    else if (block.size != sizeof(TTSharedHeader) + header->clusters * sizeof(TCluster))
+        reason = "truncated segment";
+
+    if (reason != nullptr) {
+        std::cout << "info string rejected shared hash " << name << ": " << reason << std::endl;
+        memory::free(block);
+        return false;
+    }
+
+    release();
+
+    memory_ = block;
+    segment_ = name;
+    shared_ = header;
+    entries_ = clusters_ptr;
+    size_ = header->clusters;
+    size_mb_ = header->size_mb;
+
+    // count this process before the segment is published, otherwise a process which attaches
+    // and detaches in between would drop the count to 0 and unlink the segment
+    const uint32_t processes = ++header->attached;
+
+    if (created) {
+        clear(threads);
+        header->ready = TTSharedHeader::MAGIC;
+    }
+
+    generation_ = header->generation;
+    epoch_ = generation_ + GENERATION_DELTA;
+
+    std::cout << "info string " << (created ? "created" : "attached to") << " shared hash "
+              << name << " with " << size_mb_ << " MB, " << processes << " processes attached"
+              << std::endl;
+
+    return true;
+}
+
+void TranspositionTable::detach(int threads) {
+    if (shared_ == nullptr) return;
+
+    const std::string name = segment_;
+
+    release();
+
+    std::cout << "info string detached from shared hash " << name << std::endl;
+
+    allocate(clustersMB(size_mb_), threads);
+}
+
+void TranspositionTable::release() {
+    if (shared_ != nullptr && --shared_->attached == 0) memory::unlinkShared(segment_);
+
+    memory::free(memory_);
+
+    segment_.clear();
+    shared_ = nullptr;
+    entries_ = nullptr;
+    size_ = 0;
+}
+
+bool TranspositionTable::sizeFixed() const {
+    if (shared_ == nullptr) return false;
+
+    std::cout << "info string hash size is fixed to " << size_mb_ << " MB by the shared segment "
+              << segment_ << std::endl;
+    return true;
+}
+
+void TranspositionTable::newSearch() {
+    if (shared_ != nullptr) {
+        // The other processes lag behind the shared generation, their entries would look
+        // like they belong to a previous game. The epoch is kept one generation ahead,
+        // so every entry with a bound stays valid.
+        generation_ = shared_->generation.fetch_add(GENERATION_DELTA) + GENERATION_DELTA;
+        epoch_ = generation_ + GENERATION_DELTA;
+        return;
+    }
+
+    generation_ += GENERATION_DELTA;
+
+    // After a full generation cycle the epoch can no longer be told apart,
+    // drag it along so that the whole current game stays valid.
+    if (generation_ == epoch_) epoch_ += GENERATION_DELTA;
+}
+
+void TranspositionTable::newGame() {
+    if (shared_ != nullptr) {
+        newSearch();
+        return;
+    }
+
+    generation_ += GENERATION_DELTA;
+    epoch_ = generation_;
+}
 
 int TranspositionTable::hashfull() const {
+    const U64 samples = std::min(U64(1000), size_);
     int used = 0;
-    for (size_t i = 0; i < 1000; i++) {
-        used += entries_[i].flag != NONEBOUND;
+
+    for (U64 i = 0; i < samples; i++) {
+        for (const auto &entry : entries_[i].entries) {
+            used += !isEmpty(entry) && entry.generation() == generation_;
+        }
     }
-    return used;
+
+    return used * 1000 / (samples * TCluster::SIZE);
 }
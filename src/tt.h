@@ -1,26 +1,136 @@
 #pragma once
 
-#include <vector>
+#include <array>
+#include <string>
 
 #include "builtin.h"
 #include "helper.h"
+#include "memory.h"
 #include "types.h"
 
+#ifdef TT_COMPACT
+// Only the lower 16 bits of the hash are stored. The cluster index is derived from the
+// upper bits, so both are independent and about log2(clusters) + 16 bits are verified.
+// A probe of a position which is not stored falsely hits with a chance of roughly
+// TCluster::SIZE / 2^16 (6 / 65536 = 9.2e-5) once the cluster is full. A wrong TT move
+// is filtered by the legality check in the MovePicker, a wrong score is tolerated.
+using TKey = uint16_t;
+#else
+using TKey = U64;
+#endif
 
 PACK(struct TEntry {
-    U64 key = 0;
+    TKey key = 0;
     Score score = 0;
+    // static evaluation before the halfmove scaling (eval::rawEvaluate), VALUE_NONE if it was
+    // not computed
+    Score eval = 0;
     Move move = NO_MOVE;
     uint8_t depth = 0;
-    Flag flag = NONEBOUND;
+    // lower 2 bits hold the bound, upper 6 bits the search generation
+    uint8_t age_bound = NONEBOUND;
+
+    [[nodiscard]] Flag flag() const { return Flag(age_bound & 0x3); }
+
+    [[nodiscard]] uint8_t generation() const { return age_bound & 0xFC; }
+
+    /// @brief the part of the hash which is stored in the entry
+    [[nodiscard]] static constexpr TKey verification(U64 key) { return static_cast<TKey>(key); }
 });
 
+// A cluster fills exactly one cache line, so a probe costs a single memory fetch
+struct alignas(64) TCluster {
+    static constexpr int SIZE = 64 / sizeof(TEntry);
+
+    std::array<TEntry, SIZE> entries = {};
+};
+
+static_assert(sizeof(TCluster) == 64, "TCluster must fill exactly one cache line");
+
+// TT usage counters, every search thread owns one and they are summed up after the search
+struct TTStats {
+    U64 probes = 0;
+    U64 hits = 0;
+    U64 cutoffs = 0;
+
+    // misses in a cluster which holds other positions
+    U64 collisions = 0;
+
+    // stores by the slot which was written to
+    U64 stores_empty = 0;
+    U64 stores_same = 0;
+    U64 evictions_aged = 0;
+    U64 evictions_depth = 0;
+
+    // relative age of the entries which were hit, the last bucket holds all older ones
+    std::array<U64, 4> hit_ages = {};
+
+    TTStats &operator+=(const TTStats &other);
+
+    [[nodiscard]] std::string summary() const;
+};
+
+// Header in front of the clusters of a shared table, defined in tt.cpp
+struct TTSharedHeader;
+
 class TranspositionTable {
    private:
-    std::vector<TEntry> entries_;
+    memory::Block memory_;
+
+    // name of the shared memory segment the table lives in, empty for a private table
+    std::string segment_;
+    TTSharedHeader *shared_ = nullptr;
+
+    TCluster *entries_ = nullptr;
+    U64 size_ = 0;
+
+    // size requested by allocateMB
+    U64 size_mb_ = 0;
+
+    // Incremented once per search, occupies the upper 6 bits of TEntry::age_bound
+    uint8_t generation_ = 0;
+
+    // Generation at which the current game started, entries written before it are stale
+    uint8_t epoch_ = 0;
+
+    static constexpr int GENERATION_DELTA = 4;
+    // the bound bits are offset so they never borrow from the generation bits
+    static constexpr int GENERATION_CYCLE = 255 + GENERATION_DELTA;
+    static constexpr int GENERATION_MASK = 0xFC;
+
+    /// @brief how many searches ago the entry was written
+    [[nodiscard]] int relativeAge(const TEntry &tte) const {
+        return ((GENERATION_CYCLE + generation_ - tte.age_bound) & GENERATION_MASK) /
+               GENERATION_DELTA;
+    }
+
+    /// @brief number of clusters which fit into size_mb MB
+    [[nodiscard]] static U64 clustersMB(U64 size_mb);
+
+    /// @brief worth of an entry when choosing which one to replace, deep and recent ones are kept
+    [[nodiscard]] int replaceValue(const TEntry &tte) const {
+        return tte.depth - 8 * relativeAge(tte);
+    }
+
+    /// @brief prints a message and returns true if the size is fixed by a shared segment
+    [[nodiscard]] bool sizeFixed() const;
+
+    /// @brief unmap the shared segment, the last process to release it removes the segment
+    void release();
+
+    /// @brief entries from a previous game or without a bound are treated as empty
+    [[nodiscard]] bool isEmpty(const TEntry &tte) const {
+        return tte.flag() == NONEBOUND ||
+               relativeAge(tte) > ((GENERATION_CYCLE + generation_ - epoch_) & GENERATION_MASK) /
+                                      GENERATION_DELTA;
+    }
 
    public:
     TranspositionTable();
+    ~TranspositionTable();
+
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
 
     /// @brief store an entry in the TT
     /// @param depth
@@ -28,26 +138,83 @@ class TranspositionTable {
     /// @param b Type of bound
     /// @param key Position hash
     /// @param move
-    void store(int depth, Score bestvalue, Flag b, U64 key, Move move);
+    /// @param eval static evaluation or VALUE_NONE, keeps the cached one of the same position
+    /// @param stats counters of the calling thread, nullptr if they are not collected
+    void store(int depth, Score bestvalue, Flag b, U64 key, Move move, Score eval,
+               TTStats *stats);
 
     /// @brief probe the TT for an entry
     /// @param tte
     /// @param tt_hit
     /// @param key Position hash
-    [[nodiscard]] const TEntry *probe(bool &tt_hit, Move &ttmove, U64 key) const;
+    /// @param stats counters of the calling thread, nullptr if they are not collected
+    [[nodiscard]] const TEntry *probe(bool &tt_hit, Move &ttmove, U64 key, TTStats *stats);
 
-    /// @brief calculates the TT index of key
+    /// @brief calculates the cluster index of key
     /// @param key
     /// @return
     [[nodiscard]] uint32_t index(U64 key) const;
 
     /// @brief allocate Transposition Table and initialize entries_
-    void allocate(U64 size);
+    /// @param size number of clusters
+    /// @param threads number of threads used to clear the new table
+    void allocate(U64 size, int threads = 1);
+
+    /// @brief move all entries into a new table of size clusters, on collisions
+    /// the more valuable entry is kept. Compact entries can not be rehashed, they are dropped.
+    /// @param size number of clusters
+    /// @param threads number of threads used to rehash the entries
+    /// @return number of entries which survived
+    U64 resize(U64 size, int threads = 1);
+
+    /// @brief allocate size_mb MB, does nothing if the number of clusters did not change.
+    /// An existing table is resized and keeps its entries, unless they are compact.
+    /// @param size_mb
+    /// @param threads
+    void allocateMB(U64 size_mb, int threads = 1);
+
+    /// @brief clear the TT, the work is split across threads
+    /// @param threads
+    void clear(int threads = 1);
+
+    /// @brief write the table to a snapshot file
+    /// @param path
+    /// @return false if the file could not be written
+    bool save(const std::string &path) const;
+
+    /// @brief load a snapshot written by save, the table is resized to the size of the snapshot.
+    /// Snapshots of a different entry format or network are rejected.
+    /// @param path
+    /// @param threads number of threads used to copy the table
+    /// @return false if the snapshot was rejected
+    bool load(const std::string &path, int threads = 1);
+
+    /// @brief move the table into the named shared memory segment, creating it with size_mb MB
+    /// if it does not exist. An existing segment keeps its size and entries.
+    /// Other processes attached to the segment read and write the same entries.
+    /// @param name
+    /// @param size_mb
+    /// @param threads number of threads used to clear a new segment
+    /// @return false if the segment could not be attached
+    bool attach(const std::string &name, U64 size_mb, int threads = 1);
+
+    /// @brief leave the shared segment and continue with an empty private table of the same size
+    /// @param threads
+    void detach(int threads = 1);
+
+    [[nodiscard]] const std::string &segment() const { return segment_; }
+
+    [[nodiscard]] U64 sizeMB() const { return size_mb_; }
+
+    [[nodiscard]] U64 clusters() const { return size_; }
 
-    void allocateMB(U64 size_mb);
+    /// @brief advance the generation, called once at the start of every search.
+    /// A shared table advances the generation of all attached processes.
+    void newSearch();
 
-    /// @brief clear the TT
-    void clear();
+    /// @brief start a new epoch, all existing entries become stale without touching the table.
+    /// The entries of a shared table belong to other processes as well and are kept.
+    void newGame();
 
     template <int rw = 0>
     void prefetch(U64 key) const {
@@ -56,6 +223,6 @@ class TranspositionTable {
 
     [[nodiscard]] int hashfull() const;
 
-    // 57344 MiB = 2^32 * 14B / (1024 * 1024)
-    static constexpr U64 MAXHASH_MiB = (1ull << 32) * sizeof(TEntry) / (1024 * 1024);
-};
\ No newline at end of file
+    // 256 GiB = 2^32 * 64B / (1024 * 1024 * 1024)
+    static constexpr U64 MAXHASH_MiB = (1ull << 32) * sizeof(TCluster) / (1024 * 1024);
+};
@@ -1,9 +1,92 @@
 #pragma once
 
+#include <algorithm>
+
 #include "../types.h"
 
 #include "../nnue.h"
 
+// Pieces which changed with the move that led to a ply. The accumulator of the ply is only
+// computed from its parent once it is evaluated, pruned nodes never pay for the update.
+struct DirtyPieces {
+    // a moved piece is removed from its square and added on the new one,
+    // a capture promotion or castling changes the most pieces
+    std::array<nnue::Feature, 2> added;
+    std::array<nnue::Feature, 2> removed;
+    int added_count = 0;
+    int removed_count = 0;
+
+    // the king of a perspective changed its bucket, that perspective has to be refreshed
+    // from the board while the other one is still updated incrementally
+    std::array<bool, 2> refresh = {};
+
+    // king squares before the move
+    Square ksq_white = SQ_A1;
+    Square ksq_black = SQ_A1;
+
+    void add(Piece piece, Square sq) {
+        assert(added_count < static_cast<int>(added.size()));
+        added[added_count++] = {piece, sq};
+    }
+
+    void remove(Piece piece, Square sq) {
+        assert(removed_count < static_cast<int>(removed.size()));
+        removed[removed_count++] = {piece, sq};
+    }
+
+    void move(Piece piece, Square from_sq, Square to_sq) {
+        remove(piece, from_sq);
+        add(piece, to_sq);
+    }
+
+    /// @brief compute one perspective of this ply from the accumulator of the parent
+    /// @param parent
+    /// @param acc
+    /// @param perspective
+    void apply(const nnue::accumulator &parent, nnue::accumulator &acc, Color perspective) const {
+        assert(!refresh[perspective]);
+
+        nnue::update(parent[perspective], acc[perspective], perspective,
+                     perspective == WHITE ? ksq_white : ksq_black, added.data(), added_count,
+                     removed.data(), removed_count);
+    }
+};
+
+// Accumulator of every perspective and king bucket together with the pieces it was computed
+// from ("Finny table"). A refresh starts from the entry of the new bucket and only applies
+// the pieces which differ, instead of activating every piece from the bias.
+struct RefreshCache {
+    struct Entry {
+        alignas(32) nnue::perspective_accumulator acc = {};
+        std::array<Bitboard, 12> pieces = {};
+    };
+
+    /// @brief the entry of a perspective and bucket, entries of a previous network are reset
+    /// @param perspective
+    /// @param bucket
+    /// @return
+    Entry &get(Color perspective, int bucket) {
+        if (version != nnue::networkVersion()) {
+            for (auto &side : entries) {
+                for (auto &entry : side) {
+                    std::copy(HIDDEN_BIAS, HIDDEN_BIAS + nnue::hiddenSize(), entry.acc.begin());
+                    entry.pieces = {};
+                }
+            }
+
+            version = nnue::networkVersion();
+        }
+
+        return entries[perspective][bucket];
+    }
+
+private:
+    std::array<std::array<Entry, BUCKETS>, 2> entries;
+
+    // 0 is never a loaded network, the entries start out invalid
+    uint32_t version = 0;
+};
+
 struct Accumulators {
     Accumulators() { assert(alignof(accumulators) == 32); };
 
@@ -12,12 +95,18 @@ struct Accumulators {
         return index;
     }
 
-    void clear() { index = 0; }
+    // the root is computed by refreshing it from the board
+    void clear() {
+        index = 0;
+        computed[0] = {true, true};
+    }
 
     void push() {
         assert(index + 1 < MAX_PLY + 1);
         index++;
-        accumulators[index] = accumulators[index - 1];
+        computed[index] = {false, false};
+        dirty_pieces[index] = DirtyPieces();
+        pushes_++;
     }
 
     void pop() {
@@ -25,12 +114,86 @@ struct Accumulators {
         index--;
     }
 
-    nnue::accumulator &back() {
+    /// @brief changes of the current ply, filled in by makeMove
+    DirtyPieces &dirty() {
+        assert(index > 0 && index < MAX_PLY + 1);
+        return dirty_pieces[index];
+    }
+
+    [[nodiscard]] const DirtyPieces &dirty() const {
+        assert(index > 0 && index < MAX_PLY + 1);
+        return dirty_pieces[index];
+    }
+
+    /// @brief the accumulator of the current ply, pending changes are applied to it first.
+    /// @param refresh called with the accumulator of the current ply and a perspective
+    /// when that perspective has to be computed from the board
+    template <typename Refresh>
+    nnue::accumulator &back(Refresh &&refresh) {
         assert(index >= 0 && index < MAX_PLY + 1);
+
+        if (computed[index][WHITE] && computed[index][BLACK]) return accumulators[index];
+
+        // walk back to the last computed ancestor of each perspective
+        std::array<int, 2> base = {index, index};
+
+        for (Color perspective : {WHITE, BLACK}) {
+            while (!computed[base[perspective]][perspective] &&
+                   !dirty_pieces[base[perspective]].refresh[perspective])
+                base[perspective]--;
+        }
+
+        // usually both perspectives are updated from the same ancestor in one pass
+        if (base[WHITE] == base[BLACK] && computed[base[WHITE]][WHITE] &&
+            computed[base[BLACK]][BLACK]) {
+            for (int i = base[WHITE] + 1; i <= index; i++) {
+                dirty_pieces[i].apply(accumulators[i - 1], accumulators[i], WHITE);
+                dirty_pieces[i].apply(accumulators[i - 1], accumulators[i], BLACK);
+                markComputed(i, WHITE);
+                markComputed(i, BLACK);
+            }
+
+            return accumulators[index];
+        }
+
+        for (Color perspective : {WHITE, BLACK}) {
+            // the boards of earlier plies are gone, only the current one can be refreshed
+            if (!computed[base[perspective]][perspective]) {
+                refresh(accumulators[index], perspective);
+                markComputed(index, perspective);
+                continue;
+            }
+
+            for (int i = base[perspective] + 1; i <= index; i++) {
+                dirty_pieces[i].apply(accumulators[i - 1], accumulators[i], perspective);
+                markComputed(i, perspective);
+            }
+        }
+
         return accumulators[index];
     }
 
+    [[nodiscard]] RefreshCache &refreshCache() { return refresh_cache; }
+
+    /// @brief plies which were played with an accumulator update
+    [[nodiscard]] U64 pushes() const { return pushes_; }
+
+    /// @brief plies whose accumulator was never computed
+    [[nodiscard]] U64 updatesAvoided() const { return pushes_ - materialized_; }
+
 private:
     alignas(32) std::array<nnue::accumulator, MAX_PLY + 1> accumulators = {};
+    std::array<DirtyPieces, MAX_PLY + 1> dirty_pieces = {};
+    std::array<std::array<bool, 2>, MAX_PLY + 1> computed = {{{true, true}}};
+
+    RefreshCache refresh_cache;
+
+    void markComputed(int ply, Color perspective) {
+        materialized_ += !computed[ply][WHITE] && !computed[ply][BLACK];
+        computed[ply][perspective] = true;
+    }
     int index = 0;
-};
\ No newline at end of file
+
+    U64 pushes_ = 0;
+    U64 materialized_ = 0;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "../types.h"
+
+#include "../nnue.h"
+
+// Network outputs of recently evaluated positions, every search thread owns one. Siblings and
+// later iterations often evaluate the same position again, a hit also skips the accumulator
+// update of the ply. The output is cached before the halfmove scaling, which is not part of
+// the hash.
+class EvalCache {
+   public:
+    static constexpr int DEFAULT_SIZE_KB = 256;
+
+    struct Stats {
+        U64 probes = 0;
+        U64 hits = 0;
+
+        Stats &operator+=(const Stats &other) {
+            probes += other.probes;
+            hits += other.hits;
+            return *this;
+        }
+    };
+
+    EvalCache() { resize(DEFAULT_SIZE_KB); }
+
+    /// @brief resize the cache to the largest power of two number of entries which fits into
+    /// size_kb KiB, 0 disables it. Entries are kept if the size does not change.
+    /// @param size_kb
+    void resize(int size_kb) {
+        std::size_t count = 0;
+
+        if (size_kb > 0) {
+            count = 1;
+            while (count * 2 * sizeof(Entry) <= static_cast<std::size_t>(size_kb) * 1024)
+                count *= 2;
+        }
+
+        if (count == entries_.size()) return;
+
+        entries_.assign(count, Entry());
+        mask_ = count == 0 ? 0 : count - 1;
+    }
+
+    /// @brief forget every entry if the network changed since they were stored
+    void validate() {
+        if (version_ == nnue::networkVersion()) return;
+
+        std::fill(entries_.begin(), entries_.end(), Entry());
+        version_ = nnue::networkVersion();
+    }
+
+    /// @brief look up the network output of a position
+    /// @param key hash of the position
+    /// @param value set to the cached output on a hit
+    /// @return
+    [[nodiscard]] bool probe(U64 key, int32_t &value) {
+        if (entries_.empty()) return false;
+
+        stats.probes++;
+
+        const Entry &entry = entries_[key & mask_];
+        if (entry.key != verification(key)) return false;
+
+        stats.hits++;
+        value = entry.value;
+        return true;
+    }
+
+    void store(U64 key, int32_t value) {
+        if (entries_.empty()) return;
+
+        entries_[key & mask_] = {verification(key), value};
+    }
+
+    [[nodiscard]] std::size_t size() const { return entries_.size(); }
+
+    Stats stats;
+
+   private:
+    struct Entry {
+        uint32_t key = 0;
+        int32_t value = 0;
+    };
+
+    // the low bits select the entry, the high bits are stored. The lowest bit is always set,
+    // an empty entry never matches.
+    [[nodiscard]] static uint32_t verification(U64 key) {
+        return static_cast<uint32_t>(key >> 32) | 1;
+    }
+
+    std::vector<Entry> entries_;
+    U64 mask_ = 0;
+
+    // 0 is never a loaded network, the entries start out invalid
+    uint32_t version_ = 0;
+};
@@ -1,11 +1,13 @@
 #include "uci.h"
 
 #include <cmath>
+#include <iomanip>
 
 #include "syzygy/Fathom/src/tbprobe.h"
 
 #include "cli.h"
 #include "evaluation.h"
+#include "numa.h"
 #include "perft.h"
 #include "str_utils.h"
 #include "thread.h"
@@ -31,6 +33,16 @@ Uci::Uci() {
     options.add(uci::Option{"SyzygyPath", "string", "", "", "", ""});
     options.add(uci::Option{"UCI_Chess960", "check", "false", "false", "", ""});
     options.add(uci::Option{"UCI_ShowWDL", "check", "false", "false", "", ""});
+    options.add(uci::Option{"EvalCache", "spin", std::to_string(EvalCache::DEFAULT_SIZE_KB),
+                            std::to_string(EvalCache::DEFAULT_SIZE_KB), "0", "65536"});  // KiB
+    options.add(uci::Option{"HelperHistory", "combo", "inherit", "inherit", "", "",
+                            {"inherit", "persistent", "reset"}});
+    options.add(uci::Option{"DepthSkipping", "check", "false", "false", "", ""});
+    options.add(uci::Option{"Voting", "check", "false", "false", "", ""});
+    options.add(uci::Option{"TTStats", "check", "false", "false", "", ""});
+    options.add(uci::Option{"EvalCacheStats", "check", "false", "false", "", ""});
+    options.add(uci::Option{"NUMA", "check", "true", "true", "", ""});
+    options.add(uci::Option{"SharedHash", "string", "<empty>", "<empty>", "", ""});
 
     applyOptions();
 }
@@ -83,6 +95,10 @@ void Uci::processLine(const std::string& line) {
         std::cout << convertScore(eval::evaluate(board_)) << std::endl;
     } else if (tokens[0] == "print") {
         std::cout << board_ << std::endl;
+    } else if (tokens[0] == "savett" && tokens.size() > 1) {
+        saveTT(line.substr(line.find(' ') + 1));
+    } else if (tokens[0] == "loadtt" && tokens.size() > 1) {
+        loadTT(line.substr(line.find(' ') + 1));
     } else {
         std::cout << "Unknown command: " << line << std::endl;
     }
@@ -117,20 +133,78 @@ void Uci::applyOptions() {
     if (!eval_file.empty()) {
         std::cout << "info string EvalFile " << eval_file << std::endl;
         nnue::init(eval_file.c_str());
+
+        // the accumulator of the current position belongs to the previous network
+        board_.refreshNNUE(board_.getAccumulator());
     }
 
     worker_threads_ = options.get<int>("Threads");
+    Threads.setEvalCacheSize(options.get<int>("EvalCache"));
+    Threads.setTTStats(options.get<bool>("TTStats"));
+
+    const auto helper_history = options.get<std::string>("HelperHistory");
+    Threads.setHelperHistory(helper_history == "reset"        ? HelperHistory::RESET
+                             : helper_history == "persistent" ? HelperHistory::PERSISTENT
+                                                              : HelperHistory::INHERIT);
+    Threads.setDepthSkipping(options.get<bool>("DepthSkipping"));
+    Threads.setVoting(options.get<bool>("Voting"));
     board_.chess960 = options.get<bool>("UCI_Chess960");
 
-    TTable.allocateMB(options.get<int>("Hash"));
+    // the pages only move to other nodes if the table is copied into new memory
+    if (options.get<bool>("NUMA") != numa::enabled()) {
+        numa::setEnabled(options.get<bool>("NUMA"));
+
+        if (TTable.segment().empty()) {
+            static_cast<void>(TTable.resize(TTable.clusters(), worker_threads_));
+        }
+    }
+
+    auto segment = options.get<std::string>("SharedHash");
+    if (segment == "<empty>") segment.clear();
+
+    if (segment != TTable.segment()) {
+        if (segment.empty()) {
+            TTable.detach(worker_threads_);
+        } else if (!TTable.attach(segment, options.get<int>("Hash"), worker_threads_)) {
+            const auto attached = TTable.segment().empty() ? "<empty>" : TTable.segment();
+            options.set("setoption name SharedHash value " + attached);
+        }
+
+        // an existing segment dictates the size
+        options.set("setoption name Hash value " + std::to_string(TTable.sizeMB()));
+    }
+
+    TTable.allocateMB(options.get<int>("Hash"), worker_threads_);
+
+    // a shared segment refuses to be resized, the option has to show the size in use
+    if (!TTable.segment().empty()) {
+        options.set("setoption name Hash value " + std::to_string(TTable.sizeMB()));
+    }
+}
+
+void Uci::saveTT(const std::string& path) {
+    // a running search would write entries while they are copied
+    Threads.kill();
+
+    static_cast<void>(TTable.save(path));
+}
+
+void Uci::loadTT(const std::string& path) {
+    Threads.kill();
+
+    // keep the Hash option in sync, otherwise the next setoption would resize the table
+    if (TTable.load(path, worker_threads_)) {
+        options.set("setoption name Hash value " + std::to_string(TTable.sizeMB()));
+    }
 }
 
 void Uci::isReady() { std::cout << "readyok" << std::endl; }
 
 void Uci::uciNewGame() {
     board_ = Board();
-    TTable.clear();
     Threads.kill();
+    Threads.clear();
+    TTable.newGame();
 }
 
 void Uci::position(const std::string& line) {
@@ -325,4 +399,19 @@ void output(int score, int ply, int depth, uint8_t seldepth, U64 nodes, U64 tbHi
     std::cout << ss.str() << std::endl;
 }
 
-}  // namespace uci
\ No newline at end of file
+void outputTTStats(const TTStats& stats) {
+    if (!options.get<bool>("TTStats")) return;
+
+    std::cout << "info string " << stats.summary() << std::endl;
+}
+
+void outputEvalCacheStats(const EvalCache::Stats& eval_cache) {
+    if (!options.get<bool>("EvalCacheStats")) return;
+
+    std::cout << "info string eval cache probes " << eval_cache.probes << " hits "
+              << eval_cache.hits << " (" << std::fixed << std::setprecision(1)
+              << (eval_cache.probes ? eval_cache.hits * 100.0 / eval_cache.probes : 0.0)
+              << "%)" << std::defaultfloat << std::endl;
+}
+
+}  // namespace uci
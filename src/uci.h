@@ -4,6 +4,7 @@
 #include "movegen.h"
 #include "options.h"
 #include "timemanager.h"
+#include "types/eval_cache.h"
 
 namespace uci {
 
@@ -22,6 +23,12 @@ class Uci {
 
     static void isReady();
 
+    // write a TT snapshot, a running search is stopped first
+    static void saveTT(const std::string& path);
+
+    // load a TT snapshot written by savett
+    void loadTT(const std::string& path);
+
     void uciNewGame();
     void position(const std::string& line);
 
@@ -49,4 +56,10 @@ class Uci {
 
 void output(int score, int ply, int depth, uint8_t seldepth, U64 nodes, U64 tbHits, int time,
             const std::string& pv, int hashfull);
+
+// prints the TT statistics of the search if enabled by the TTStats option
+void outputTTStats(const TTStats& stats);
+
+// prints the eval cache hit rate of the search if enabled by the EvalCacheStats option
+void outputEvalCacheStats(const EvalCache::Stats& eval_cache);
 }  // namespace uci